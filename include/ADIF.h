@@ -10,15 +10,17 @@
 
 #include <SD.h>
 
+// Locator of a logged QSO, the vector is worked out against the map on show
 struct Map_Memory
 {
-    float ADIF_distance;
-    float ADIF_map_distance;
-    float ADIF_map_bearing;
+    char locator[7];
 };
 
 void draw_map(int16_t index);
 void write_ADIF_Log(void);
+
+// Remember a logged locator for the map and draw its vector
+void add_map_entry(const char *locator);
 void Init_Log_File(void);
 
 void set_Station_Coordinates();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "arm_math.h"
+#include "dt_estimator.h"
 
 #define FFT_BASE_SIZE 1024
 #define FFT_SIZE FFT_BASE_SIZE * 2
@@ -12,7 +13,29 @@
 #define FFT_Resolution 6.25
 #define ft8_msg_samples 91
 
+// The spectrogram is a ring of ft8_ring_blocks FFT blocks (~1.5 slots) that is
+// written continuously, so a decode window can reach across the slot boundary.
+#define ft8_ring_blocks 136
+#define ft8_lookback_blocks 8 // blocks before the slot start included in a decode window
+#define ft8_late_blocks 2     // blocks after ft8_msg_samples before the decode fires
+#define ft8_decode_blocks (ft8_lookback_blocks + ft8_msg_samples + ft8_late_blocks)
+
 extern uint8_t export_fft_power[];
+extern uint32_t decode_start_block;
+extern DT_Epoch decode_epoch; // timing the window being decoded was captured under
 
 void init_DSP(void);
 void process_FT8_FFT(void);
+void mark_slot_start(void);
+void queue_FT8_decode(void);
+
+// The FFT has not yet written over any block of the window being decoded
+bool decode_window_valid(void);
+
+// Make the oldest queued window that can still be decoded the current one,
+// false when there is none. Windows the FFT has written over are logged
+// and skipped.
+bool take_FT8_decode(void);
+
+// Windows are waiting for the decoder
+bool FT8_decode_queued(void);
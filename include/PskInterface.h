@@ -4,10 +4,14 @@
 #ifndef PSK_INTERFACE_H
 #define PSK_INTERFACE_H
 
+// Nothing here waits on the ESP32: getTime() and addReceivedRecord() only
+// queue work, pskStep() carries out one I2C transaction of it at a time
+void pskBegin(void);
 void requestTimeSync();
 void getTime();
-bool addSenderRecord(const char *callsign, const char *gridSquare, const char *software);
 bool addReceivedRecord(const char *callsign, uint32_t frequency, uint8_t snr);
+bool pskPending(void);
+void pskStep(void);
 bool sendRequest(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fields of one ADIF record the radio cares about, NUL terminated and
+// empty when the record does not have them
+struct Adif_Record
+{
+  char call[16];
+  char gridsquare[9];
+  char freq[12]; // MHz
+  char band[8];  // e.g. 20m
+  char qso_date[9];
+  char time_on[7];
+  char rst_sent[8];
+  char rst_rcvd[8];
+};
+
+typedef void (*adif_handler_t)(const Adif_Record *record, void *user);
+
+// Incremental ADIF parser. Data can be fed in pieces of any size, records
+// may span lines and tags are matched without regard to case. The header
+// up to <eoh> and unknown fields are skipped.
+struct Adif_Reader
+{
+  adif_handler_t handler;
+  void *user;
+
+  uint8_t state;
+  char tag[24];
+  uint8_t tag_len;
+  uint16_t value_len;  // declared length of the current field
+  uint16_t value_pos;  // characters of it seen so far
+  char *value;         // destination in record, NULL for skipped fields
+  uint8_t value_size;
+  Adif_Record record;
+};
+
+void adif_reader_init(Adif_Reader *reader, adif_handler_t handler, void *user);
+
+// Parse the next len bytes, calling the handler for each complete record
+void adif_reader_feed(Adif_Reader *reader, const char *data, size_t len);
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+// Records the decimated 6.4 kS/s receive audio to SD, one WAV file per slot
+// in RECORD_DIR. process_data() only copies into RAM buffers; a background
+// task writes each full buffer as whole sectors. When the card falls behind
+// audio is dropped and counted, the audio path never waits for it; the
+// dropped samples are written as silence so the file keeps its time axis.
+
+#define RECORD_DIR "REC"
+#define RECORD_SAMPLE_RATE 6400
+
+// Clear the buffers, which live in memory that is not zeroed at startup
+void recorder_begin(void);
+
+// Start recording at the next slot, or stop at the end of the current one
+void recorder_toggle(void);
+
+// Called at every slot boundary with the wall clock start of the new slot
+void recorder_slot_start(time_t slot_time);
+
+// Called with each block of decimated samples
+void recorder_push(const int16_t *samples, int num_samples);
+
+// A buffer is waiting to be written or a finished file to be closed
+bool recorder_pending(void);
+
+void recorder_write(void);
@@ -37,6 +37,7 @@ enum BandIndex
 
 void drawButton(uint16_t i);
 void checkButton(void);
+void build_touch_index(void);
 void executeButton(uint16_t index);
 void display_all_buttons(void);
 int FT8_Touch(void);
@@ -21,7 +21,6 @@ extern const int K_BYTES;             // Number of whole bytes needed to store K
 extern const uint16_t CRC_POLYNOMIAL; // CRC-14 polynomial without the leading (MSB) 1
 extern const int CRC_WIDTH;           // CRC width in bits
 
-extern uint8_t tones[79];
 
 // Costas 7x7 tone pattern
 extern const uint8_t kCostas_map[7];
@@ -52,4 +51,32 @@ extern const uint8_t kMn[174][3];
 // Number of rows (columns in C/C++) in the array Nm.
 extern const uint8_t kNrw[83];
 
+// Tanner graph of the LDPC(174,91) code, generated from kNm and kMn at compile time.
+// The 522 edges are numbered check by check in kNm order, all indices are zero-based.
+struct Tanner_Graph
+{
+    uint16_t check_edges[83 + 1];  // first edge of each check, check_edges[83] is the edge count
+    uint8_t edge_bits[522];        // codeword bit of each edge
+    uint16_t bit_edges[174][3];    // edges of each codeword bit, in kMn order
+    uint64_t check_masks[83][3];   // codeword bits of each check, packed MSB first (see Bits174)
+};
+
+extern const Tanner_Graph kTanner_graph;
+
+// kGenerator rows as big-endian 32-bit words, generated at compile time
+struct Generator_Words
+{
+    uint32_t rows[83][3];
+};
+
+extern const Generator_Words kGenerator_words;
+
+// CRC-14 remainders of every byte value, generated at compile time from CRC_POLYNOMIAL
+struct Crc_Table
+{
+    uint16_t values[256];
+};
+
+extern const Crc_Table kCrc_table;
+
 #endif /* CONSTANTS_H_ */
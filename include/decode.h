@@ -19,16 +19,32 @@ struct Candidate
     uint8_t freq_sub;
 };
 
+// A decode window of num_blocks FFT blocks taken from a circular spectrogram.
+// Each block holds 4 rows (time_sub, freq_sub) of num_bins power values,
+// block b of the window is stored at ring position (first_block + b) % ring_blocks.
+struct Spectrogram
+{
+    const uint8_t *power;
+    int ring_blocks;
+    int first_block;
+    int num_blocks;
+    int num_bins;
+};
+
 // Localize top N candidates in frequency and time according to their sync strength (looking at Costas symbols)
 // We treat and organize the candidate list as a min-heap (empty initially).
-int find_sync(const uint8_t *power, int num_blocks, int num_bins,
-              const uint8_t *sync_map, int num_candidates, Candidate *heap,
-              int min_score);
+// Candidate time offsets are in blocks relative to the start of the window.
+int find_sync(const Spectrogram *spectrogram, const uint8_t *sync_map,
+              int num_candidates, Candidate *heap, int min_score);
 
-// Compute log likelihood log(p(1) / p(0)) of 174 message bits
-// for later use in soft-decision LDPC decoding
+// Largest number of symbols combined by extract_likelihood()
+#define kMax_likelihood_syms 3
 
-void extract_likelihood(const uint8_t *power, int num_bins, Candidate cand,
-                        const uint8_t *code_map, float *log174);
+// Compute log likelihood log(p(1) / p(0)) of 174 message bits
+// for later use in soft-decision LDPC decoding.
+// n_syms (1..kMax_likelihood_syms) consecutive symbols are evaluated jointly,
+// which gains sensitivity at the cost of 8^n_syms metrics per group.
+void extract_likelihood(const Spectrogram *spectrogram, Candidate cand,
+                        const uint8_t *code_map, int n_syms, float *log174);
 
 #endif /* DECODE_H_ */
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+// Archive of every decode on the SD card, one pair of files per UTC day in
+// ARCHIVE_DIR. YYYYMMDD.DEC holds fixed size records in the order they were
+// decoded, YYYYMMDD.IDX one entry per slot pointing at its first record.
+// The payload is kept packed, so the text can be produced again by a later
+// unpack77(), or on a PC by scripts/all_txt.py.
+
+#define ARCHIVE_DIR "ARCHIVE"
+
+struct Archive_Record
+{
+  uint32_t slot_time; // start of the slot, seconds since 1970
+  uint16_t dial_khz;
+  uint16_t freq_hz; // audio offset
+  int16_t dt_ms;
+  int8_t snr;
+  uint8_t flags; // reserved, 0
+  uint8_t payload[10]; // the 77 message bits, MSB first
+  uint8_t spare[2];
+};
+
+struct Archive_Index
+{
+  uint32_t slot_time;
+  uint32_t first_record;
+  uint32_t num_records;
+};
+
+void archive_begin(void);
+
+// Queue one decode of the slot starting at slot_time
+void archive_add(time_t slot_time, int dial_khz, int freq_hz, int dt_ms, int snr, const uint8_t *a77);
+
+// Decodes are queued for writing and the card is not in a retry backoff
+bool archive_pending(void);
+
+// Append the queued slot to today's files. When that fails the slot stays
+// queued, and is dropped and counted if the next slot arrives first
+void archive_flush(void);
+
+// Print the last num_slots slots of today in WSJT-X ALL.TXT format,
+// num_slots < 0 prints the whole day
+void archive_dump(int num_slots);
@@ -8,7 +8,13 @@
 #ifndef DECODE_FT8_H_
 #define DECODE_FT8_H_
 
-int ft8_decode(void);
+// The decode of a slot runs as a series of short steps, so that the audio
+// and FFT tasks keep running in between: the sync search, then one LDPC
+// batch per step. ft8_decode_begin() takes the queued window, each
+// ft8_decode_step() returns -1 while there is more to do and then the
+// number of messages it has left in new_decoded[]
+void ft8_decode_begin(void);
+int ft8_decode_step(void);
 
 extern int max_sync_score;
 extern int max_sync_score_index;
@@ -30,6 +36,7 @@ struct Decode
     int sync_score;
     int snr;
     int received_snr;
+    int dt_ms;
     char target_locator[7];
     int target_distance;
     int slot;
@@ -79,7 +86,9 @@ void clear_qso_region(void);
 void display_queued_message(const char *msg);
 void display_txing_message(const char *msg);
 void display_qso_state(const char *txt);
-char *add_worked_qso(void);
+// Append band, call and the RX/TX reports to the worked QSO list,
+// band is a BandIndex or NumBands when unknown
+void add_worked_qso(int band, const char *call, int rx_rsl, int tx_rsl);
 bool display_worked_qsos(void);
 
 void display_call_list_item(int left, int line, MsgColor background, MsgColor textcolor, const char *text);
@@ -89,9 +98,8 @@ void display_logged_list_item(int left, int line, MsgColor background, MsgColor
 void display_logged_list(int number_calls);
 
 int check_call_list(int message_index);
-int check_log_list(int message_index);
 void store_CQ_Call(void);
-void store_logged_CQ_Call(const char *call);
+void store_logged_CQ_Call(void);
 void clear_auto_memories(void);
 
 int strindex(const char *s, const char *t);
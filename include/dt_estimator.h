@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+// Block timing used to convert a candidate position into a time offset
+#define FT8_BLOCK_MS 160
+#define FT8_TX_START_MS 500 // FT8 transmissions nominally start 0.5 s into the slot
+
+// Time offset (ms) of a decode relative to the nominal start of the slot,
+// block is the candidate block counted from the slot start
+int dt_from_candidate(int block, int time_sub);
+
+// The slot timing a decode window was captured under. Windows are decoded
+// after the boundary at which a correction is worked out, and the correction
+// only reaches start_time seconds later, so each decode says which timing
+// it was measured against.
+struct DT_Epoch
+{
+  uint16_t sync;      // dt_reset() calls so far
+  int32_t applied_ms; // corrections applied to start_time since then
+};
+
+// Timing in effect now, taken when a slot starts
+DT_Epoch dt_epoch(void);
+
+// Record the time offset of one decode measured under epoch. It is moved by
+// the corrections worked out since, decodes from before a dt_reset() are
+// dropped.
+void dt_record(int dt_ms, DT_Epoch epoch);
+
+// Called at the slot boundary, returns the start_time correction (ms) to apply
+int dt_end_of_slot(void);
+
+// A correction returned by dt_end_of_slot() has been added to start_time
+void dt_applied(int step_ms);
+
+// Forget all samples, e.g. after a manual sync
+void dt_reset(void);
+
+// Print the recent corrections on the serial port
+void dt_print_history(void);
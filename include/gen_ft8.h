@@ -25,6 +25,13 @@ extern char Target_Locator[7]; // four character locator  + /0
 extern char Free_Text1[MESSAGE_SIZE];
 extern char Free_Text2[MESSAGE_SIZE];
 
+// Tone sequence of the message queued for transmission
+extern const uint8_t *tx_tones;
+
+// Encode tx_msg into the TX message cache, if it is not there already
+void cache_custom_text(const char *tx_msg);
+
+// Make tx_msg the next transmission, a pointer swap when it is already cached
 void queue_custom_text(const char *tx_msg);
 
 #endif /* GEN_FT8_H_ */
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "symbol_clock.h"
+
+#define GFSK_STEPS 32 // 5 ms frequency steps per symbol for shaped transmissions
+#define GFSK_BT 2.0f  // as WSJT-X
+
+// Frequency pulse of one symbol, t in symbols from its centre
+float gfsk_pulse(float t);
+
+// Gaussian smoothed frequency trajectory of a transmission, sampled in the
+// middle of each of the GFSK_STEPS steps of every symbol. levels[] are in
+// 1 / levels_per_tone of the tone spacing, tone t is level t * levels_per_tone
+void gfsk_levels(const uint8_t tones[TX_SYMBOLS], int levels_per_tone, uint8_t levels[TX_SYMBOLS * GFSK_STEPS]);
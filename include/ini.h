@@ -2,41 +2,22 @@
 #ifndef INI_H_
 #define INI_H_
 
-// Define a maximum size for strings and the INI structure
+#include <stddef.h>
+
+// Define a maximum size for strings, longer lines are truncated
 #define MAX_SECTION_NAME_LENGTH 32
 #define MAX_KEY_LENGTH 32
 #define MAX_VALUE_LENGTH 64
-#define MAX_SECTIONS 10
-#define MAX_KEYS_PER_SECTION 20
 #define MAX_LINE_LENGTH 128
 
-// Structure to hold a key-value pair
-typedef struct
-{
-    char key[MAX_KEY_LENGTH];
-    char value[MAX_VALUE_LENGTH];
-    bool present;
-} ini_entry_t;
-
-// Structure to hold a section
-typedef struct
-{
-    char name[MAX_SECTION_NAME_LENGTH];
-    ini_entry_t entries[MAX_KEYS_PER_SECTION];
-    unsigned int num_entries;
-    bool present;
-} ini_section_t;
+// Fills buffer with up to len bytes of the file, returns 0 at the end
+typedef size_t (*ini_reader_t)(char *buffer, size_t len, void *source);
 
-// Structure to hold the entire INI data
-typedef struct
-{
-    ini_section_t sections[MAX_SECTIONS];
-    unsigned int num_sections;
-} ini_data_t;
+// Called for every key = value line, with the name of the enclosing section
+typedef void (*ini_handler_t)(const char *section, const char *key, const char *value, void *user);
 
-void parse_ini(const char *buffer, size_t buffer_len, ini_data_t *ini_data);
-const char *get_ini_value(const ini_data_t *ini_data, const char *section_name, const char *entry_key);
-const ini_section_t *get_ini_section(const ini_data_t *ini_data, const char *section_name);
-const char *get_ini_value_from_section(const ini_section_t *section, const char *entry_key);
+// Reads the whole INI file one line at a time, memory use does not depend on
+// the size of the file. Keys before the first section are ignored.
+void parse_ini(ini_reader_t reader, void *source, ini_handler_t handler, void *user);
 
 #endif
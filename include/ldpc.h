@@ -1,8 +1,49 @@
 
 #pragma once
 
-void bp_decode(float codeword[], int max_iters, uint8_t plain[], int *ok);
+#include <stdint.h>
+
+// A 174-bit codeword packed MSB first into three 64-bit words:
+// bit i is bit (63 - i % 64) of word[i / 64]
+struct Bits174
+{
+  uint64_t word[3];
+};
+
+// Sum-product decoder taking the product of the fast_tanh() terms of each
+// check, the reference for bp_decode(). The product is clamped to +-0.999999
+// so that a saturated check stays finite.
+// plain[] receives one 0/1 byte per codeword bit, ok the parity checks failed
+void ldpc_decode(float *codeword, int max_iters, uint8_t plain[], int *ok);
+
+void bp_decode(float codeword[], int max_iters, Bits174 *plain, int *ok);
+
+// Number of candidates bp_decode_batch() decodes in lockstep, one per SIMD lane.
+// Lanes only pay off with float SIMD, the Cortex-M7 has none so the Teensy
+// build decodes one candidate at a time with bp_decode()
+#ifndef LDPC_LANES
+#if defined(__AVX2__)
+#define LDPC_LANES 8
+#elif defined(__ARM_NEON) || defined(__SSE2__)
+#define LDPC_LANES 4
+#else
+#define LDPC_LANES 1
+#endif
+#endif
+
+#if LDPC_LANES > 1
+// bp_decode() on up to LDPC_LANES codewords at once. Each codeword stops
+// updating its result as soon as it passes the parity checks, the batch
+// stops when all of them have or max_iters is reached.
+void bp_decode_batch(float codewords[][174], int num_codewords, int max_iters, Bits174 plain[], int ok[]);
+#endif
+
+// Number of parity checks failed by a packed codeword, 0 means success
+int ldpc_check(const Bits174 *codeword);
 
 // Packs a string of bits each represented as a zero/non-zero byte in plain[],
 // as a string of packed bits starting from the MSB of the first byte of packed[]
 void pack_bits(const uint8_t plain[], int num_bits, uint8_t packed[]);
+
+// Copies the first num_bits of a packed codeword to bytes, MSB first
+void pack_bits(const Bits174 *plain, int num_bits, uint8_t packed[]);
@@ -0,0 +1,13 @@
+#pragma once
+
+// Reads the .adi logs on the SD card in the background after boot and puts
+// their QSOs back on the map and in the worked QSO list. When WORKED.IDX was
+// missing the worked before index is rebuilt from them as well.
+
+void log_import_begin(bool rebuild_worked_before);
+
+// True until every log has been read
+bool log_import_pending(void);
+
+// Parse the next chunk of the current log, or move on to the next one
+void log_import_step(void);
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The journal behind log_writer.cpp. It only sees files through
+// Journal_Files, the SD card on the radio and a simulated card in the host
+// tests. See log_writer.h for the order of the writes.
+
+#define JOURNAL_DATA 512      // the lines start in the sector after the header
+#define JOURNAL_MAX_DATA 2048 // longest entry, the size of the log buffer
+#define JOURNAL_SIZE (JOURNAL_DATA + JOURNAL_MAX_DATA)
+#define JOURNAL_NAME_SIZE 24
+
+// The file operations the journal needs. open() gives a file for reading
+// and writing, created when missing, or NULL. Reads and writes are at an
+// absolute offset and return the bytes transferred, sync() returns once
+// the earlier writes are on the card.
+struct Journal_Files
+{
+  void *(*open)(const char *name);
+  void (*close)(void *file);
+  uint32_t (*size)(void *file);
+  uint32_t (*read)(void *file, uint32_t offset, void *data, uint32_t len);
+  uint32_t (*write)(void *file, uint32_t offset, const void *data, uint32_t len);
+  void (*truncate)(void *file, uint32_t size);
+  void (*sync)(void *file);
+};
+
+struct Journal
+{
+  const Journal_Files *files;
+  const char *name;
+  uint32_t sequence;
+  int32_t retry_offset; // log size before an append that failed part way
+};
+
+void journal_init(Journal *journal, const Journal_Files *files, const char *name);
+
+// Allocate the journal when it is new, or finish an interrupted append.
+// Returns the bytes replayed into file_name, 0 when there was nothing to do.
+// scratch holds JOURNAL_MAX_DATA bytes.
+uint32_t journal_replay(Journal *journal, char *scratch, char file_name[JOURNAL_NAME_SIZE]);
+
+// Append len bytes to log_name through the journal. False when a file could
+// not be opened or a write fell short; the same data should be offered again,
+// it replaces whatever part of it reached the log.
+bool journal_append(Journal *journal, const char *log_name, const char *data, uint32_t len);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+
+// Buffered writer for the ADIF log. Lines are collected in RAM and written
+// out later, at a quiet moment, through a journal on the SD card:
+//
+// 1. the lines, the log file name, its size and a CRC are written to the
+//    pre-allocated journal and marked pending
+// 2. the lines are appended to the log
+// 3. the journal entry is marked committed
+//
+// A pending entry found at boot is replayed after cutting the log back to
+// the recorded size, so a power loss at any point leaves each flush either
+// fully in the log or not in it at all.
+//
+// Only the journal is pre-allocated. The log itself grows with each flush,
+// space allocated ahead of the lines would be read as part of the file by
+// the ADIF readers that open it.
+
+#define LOG_JOURNAL_FILE "ADIF.JNL"
+#define LOG_BUFFER_SIZE 2048
+
+// Replay an interrupted flush, call once the SD card is up
+void log_writer_begin(void);
+
+// Queue a line for file_name. Never writes to the card, when the buffer is
+// full the line is dropped and counted
+void log_writer_append(const char *file_name, const char *line);
+
+// Lines are waiting to be written and the card is not in a retry backoff
+bool log_writer_pending(void);
+
+// Write the waiting lines through the journal
+void log_writer_flush(void);
@@ -28,7 +28,6 @@ extern int Tune_On;
 extern int master_decoded;
 extern uint16_t cursor_freq;
 extern int ft8_flag;
-extern int ft8_xmit_counter;
 extern int slot_state;
 extern int target_slot;
 extern bool free_text;
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+// Where the large buffers live on the Teensy 4.1
+//
+// RAM1 (512 kB FlexRAM) is split between ITCM code and DTCM. Ordinary
+// globals and the stack share DTCM, so anything touched every FFT block or
+// inside the LDPC loops stays there without an attribute.
+// RAM2 (512 kB OCRAM) is slower, cached and NOT zeroed at startup; use
+// BULK_RAM for big buffers that are written before they are read or are
+// cleared explicitly.
+// LARGE_RAM is for capacity rather than speed: the optional PSRAM chip
+// when built with -D USE_PSRAM, RAM2 otherwise. It is not zeroed either.
+#if defined(__IMXRT1062__)
+#include <Arduino.h>
+#define BULK_RAM DMAMEM
+#if defined(USE_PSRAM)
+#define LARGE_RAM EXTMEM
+#else
+#define LARGE_RAM DMAMEM
+#endif
+#else
+#define BULK_RAM
+#define LARGE_RAM
+#endif
+
+// Paint the unused part of the stack, call first thing in setup()
+void memory_begin(void);
+
+// Deepest stack use seen since memory_begin(), in bytes
+uint32_t memory_stack_high_water(void);
+
+// Print the RAM1/RAM2/PSRAM budget and the stack high water mark
+void memory_print(void);
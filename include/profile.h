@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+
+#if defined(__IMXRT1062__)
+#include <Arduino.h>
+#else
+#include <time.h>
+#endif
+
+// Named timing scopes for the hot paths, dumped with the 'p' serial command
+enum Profile_Scope
+{
+  PROFILE_PROCESS_DATA = 0,
+  PROFILE_EXTRACT_POWER,
+  PROFILE_WATERFALL,
+  PROFILE_FIND_SYNC,
+  PROFILE_BP_DECODE,
+  PROFILE_DISPLAY_MESSAGES,
+  PROFILE_DRAW_MAP,
+  PROFILE_WRITE_ADIF_LOG,
+  PROFILE_LOG_FLUSH,
+  NUM_PROFILE_SCOPES
+};
+
+// CPU cycles on the Teensy, nanoseconds on a host build
+static inline uint32_t profile_ticks(void)
+{
+#if defined(__IMXRT1062__)
+  return ARM_DWT_CYCCNT;
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)(now.tv_sec * 1000000000ULL + now.tv_nsec);
+#endif
+}
+
+void profile_record(int scope, uint32_t ticks);
+
+// Print min/avg/p99/max of every scope and start again
+void profile_print(void);
+
+// Times the rest of the enclosing block
+class Profile_Timer
+{
+public:
+  explicit Profile_Timer(int scope) : scope(scope), start(profile_ticks()) {}
+  ~Profile_Timer() { profile_record(scope, profile_ticks() - start); }
+
+private:
+  int scope;
+  uint32_t start;
+};
+
+#define PROFILE_SCOPE(scope) Profile_Timer profile_timer(scope)
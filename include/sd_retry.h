@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+// Backoff for background SD writes. After a failure (no card, card full,
+// read only) the writer is not tried again for SD_RETRY_FIRST_MS, doubling
+// on each further failure up to SD_RETRY_MAX_MS, so the scheduler does not
+// keep opening files in a tight loop. One message is printed when the
+// writes start failing and one when they work again.
+
+#define SD_RETRY_FIRST_MS 2000
+#define SD_RETRY_MAX_MS 64000
+
+struct Sd_Retry
+{
+  const char *what; // named in the messages
+  uint32_t delay_ms; // 0 while the writes work
+  uint32_t failed_ms;
+};
+
+// No failure is outstanding, or its delay has passed
+bool sd_retry_due(const Sd_Retry *retry);
+
+void sd_retry_failed(Sd_Retry *retry);
+void sd_retry_ok(Sd_Retry *retry);
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+// Si5351 multisynth parameter block: P3[15:0], R_DIV/DIVBY4/P1[17:16], P1[15:0],
+// P3[19:16]/P2[19:16], P2[15:0]
+#define MS_REGS 8
+#define MS_DENOM 1000000UL
+
+// Multisynth image as last loaded into the Si5351
+struct Ms_Image
+{
+  uint8_t regs[MS_REGS];
+  bool valid;
+};
+
+// Writes bytes registers starting at addr in one I2C burst, as si5351_write_bulk()
+typedef void (*ms_write_t)(uint8_t addr, uint8_t bytes, uint8_t *data);
+
+// Fractional multisynth divider from pll_freq down to freq (both in SI5351_FREQ_MULT units)
+void calc_ms_regs(uint64_t pll_freq, uint64_t freq, uint8_t regs[MS_REGS]);
+
+// Load regs into the multisynth at base_addr. Tones only differ in the
+// fractional part of the divider, so only the span of registers that changed
+// since the last load is sent. Returns the number of registers written
+int ms_load(Ms_Image *loaded, uint8_t base_addr, const uint8_t regs[MS_REGS], ms_write_t write);
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+#define FT8_SYMBOL_US 160000 // one FT8 symbol, the same as one DSP block
+#define TX_FIRST_BLOCK 8     // the first tone goes out this many symbols into the slot
+#define TX_SYMBOLS 79
+#define TX_END_BLOCK (TX_FIRST_BLOCK + TX_SYMBOLS + 1) // receive again from here
+#define TX_MAX_LATE_US 1000000 // a start later than this skips the slot, later still would run past its end
+
+// Timing of the TX symbol timer, kept apart from the timer itself so that
+// it runs on the host against a simulated clock.
+// A transmission is split into steps, one per symbol or several when the
+// frequency is shaped, and step n is due n step periods after the slot start.
+
+struct TX_Clock_Stats
+{
+  uint32_t ticks;
+  int32_t min_error_us;
+  int32_t max_error_us;
+  int64_t sum_error_us;
+  uint32_t max_write_us;
+  uint32_t deferred;
+};
+
+struct Symbol_Clock
+{
+  int step;             // step within the slot of the next tick
+  int steps;            // steps per symbol
+  uint32_t expected_us; // when the next tick is due
+  TX_Clock_Stats stats;
+};
+
+// Start a transmission at now_us in a slot that began at slot_start_ms, in
+// the same time base as micros(). Returns the delay to the first tick.
+// A transmission started after its first symbol was due sends the whole
+// message from the next step boundary, up to TX_MAX_LATE_US late; a message
+// missing its first symbols could not be decoded. Returns 0 when it is later
+// than that and the slot is skipped
+uint32_t symbol_clock_start(Symbol_Clock *clock, int steps, uint32_t slot_start_ms, uint32_t now_us);
+
+// Account a timer tick at now_us. Returns which step of the transmission
+// to key, symbol * steps + sub step, or -1 for a tick outside the symbols
+int symbol_clock_tick(Symbol_Clock *clock, uint32_t now_us);
+
+// The tick after the last symbol has passed
+bool symbol_clock_done(const Symbol_Clock *clock);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+
+// Real-time tasks always run first, in table order. Background tasks run
+// when no real-time task is ready, earliest deadline first
+enum Task_Class
+{
+  TASK_REALTIME,
+  TASK_BACKGROUND
+};
+
+struct Task_Stats
+{
+  uint32_t runs;
+  uint64_t total_us;
+  uint32_t max_us;
+  uint32_t overruns;       // runs longer than the budget
+  uint32_t max_latency_ms; // longest wait from ready to running
+  uint32_t missed;         // runs started after the deadline
+};
+
+struct Task
+{
+  const char *name;
+  uint8_t task_class;
+  bool (*ready)(void);  // NULL for periodic tasks
+  void (*run)(void);
+  uint16_t period_ms;   // periodic tasks only
+  uint16_t deadline_ms; // allowed wait from ready to running
+  uint32_t budget_us;   // expected run time
+
+  // Kept by the scheduler
+  bool pending;
+  uint32_t release_ms;
+  Task_Stats stats;
+};
+
+// Real-time tasks must come first in the table, highest priority first
+void tasks_begin(Task *tasks, int num_tasks);
+
+// Run the most urgent ready task, if any
+void tasks_run_next(void);
+
+// Print the run-time statistics of every task on the serial port and start again
+void tasks_print_stats(void);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+#define MAXTOUCHLIMIT 10 // touch points read from the controller
+
+enum Touch_Type
+{
+  TOUCH_PRESS,
+  TOUCH_DRAG,
+  TOUCH_RELEASE
+};
+
+struct Touch_Event
+{
+  uint8_t type;
+  uint16_t x;
+  uint16_t y;
+  uint32_t time_ms; // millis() of the controller interrupt that reported it
+};
+
+// Take over the controller interrupt on int_pin
+void touch_begin(int int_pin);
+
+// Read any report the controller has flagged and queue the resulting events
+void touch_poll(void);
+
+// Returns false when no event is waiting
+bool touch_get_event(Touch_Event *event);
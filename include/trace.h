@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+// Slot timeline events, dumped with the 'x' serial command as Chrome
+// trace_event JSON (load it in chrome://tracing or ui.perfetto.dev)
+enum Trace_Event
+{
+  TRACE_SLOT = 0, // instant at the slot boundary, arg is the new slot
+  TRACE_FFT,
+  TRACE_DECODE,
+  TRACE_LDPC,    // one batch of candidates, arg is the batch size
+  TRACE_DECODED, // instant for a candidate that passed the CRC, arg is its index
+  TRACE_TX,
+  TRACE_TONE, // one frequency step written to the Si5351
+  TRACE_DISPLAY,
+  TRACE_I2C,
+  NUM_TRACE_EVENTS
+};
+
+// Safe to call from interrupts
+void trace_begin(int event, uint16_t arg = 0);
+void trace_end(int event);
+void trace_instant(int event, uint16_t arg = 0);
+
+// Print the recorded timeline on the serial port and start again
+void trace_dump(void);
+
+// Traces the rest of the enclosing block
+class Trace_Scope
+{
+public:
+  explicit Trace_Scope(int event, uint16_t arg = 0) : event(event) { trace_begin(event, arg); }
+  ~Trace_Scope() { trace_end(event); }
+
+private:
+  int event;
+};
+
+#define TRACE_SCOPE(...) Trace_Scope trace_scope(__VA_ARGS__)
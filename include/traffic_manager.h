@@ -3,7 +3,11 @@
 
 #include "arm_math.h"
 
+#define FT8_TONE_LEVELS 16 // frequency steps per tone spacing for shaped transmissions
+
 void set_FT8_Tone(uint8_t ft8_tone);
+// Key a frequency between tone 0 and tone 7, level tone * FT8_TONE_LEVELS is the tone itself
+void set_FT8_Level(uint8_t level);
 void setup_to_transmit_on_next_DSP_Flag(void);
 void tune_On_sequence(void);
 void tune_Off_sequence(void);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "symbol_clock.h"
+
+// Steer the frequency along a Gaussian smoothed trajectory (BT = 2.0, as
+// WSJT-X) instead of switching hard between tones
+extern bool gfsk_shaping;
+
+// Start keying the queued tones, slot_start_ms is the millis() time the
+// current slot began. A transmission started late is sent whole, a little
+// late, or not at all (see symbol_clock_start())
+void tx_scheduler_start(uint32_t slot_start_ms);
+
+// Stop keying, e.g. when a QSO is cleared mid transmission
+void tx_scheduler_stop(void);
+
+// Returns true once after the last symbol of a transmission
+bool tx_scheduler_finished(void);
+
+// Every loop() user of the Wire bus holds a claim while it talks to a
+// device, so the symbol interrupt never starts a tone write in the middle
+// of a transaction. A symbol that falls due meanwhile is written on release.
+// Claims nest.
+void tx_scheduler_claim_bus(void);
+void tx_scheduler_release_bus(void);
+
+class Bus_Claim
+{
+public:
+  Bus_Claim() { tx_scheduler_claim_bus(); }
+  ~Bus_Claim() { tx_scheduler_release_bus(); }
+};
+
+#define BUS_CLAIM() Bus_Claim bus_claim
+
+// Print the symbol timing of the last transmission on the serial port
+void tx_scheduler_print_stats(void);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+// Every station in the log, by callsign, with the bands it was worked on.
+// The records live in WORKED.IDX on the SD card and a hash table of
+// callsign fingerprints answers lookups without touching the card.
+
+#define WORKED_INDEX_FILE "WORKED.IDX"
+#define WORKED_CALL_SIZE 16
+#define WORKED_MODE_FT8 0
+
+// One fixed size record per logged QSO, appended to WORKED_INDEX_FILE
+struct Worked_Record
+{
+  char call[WORKED_CALL_SIZE];
+  uint8_t band; // BandIndex, NumBands when the frequency was not a known band
+  uint8_t mode;
+  uint16_t day; // days since 1970-01-01
+};
+
+// Load WORKED_INDEX_FILE. Returns false when it is missing, the index then
+// has to be rebuilt from the .adi logs with worked_before_import()
+bool worked_before_begin(void);
+
+// Add a QSO read from the logs, day counted from 1970-01-01
+void worked_before_import(const char *call, int band, uint16_t day);
+
+// All logs have been imported, close the rebuilt index
+void worked_before_import_done(void);
+
+// Was call ever logged on band (BandIndex)
+bool worked_before(const char *call, int band);
+
+// Record a QSO made today in RAM and on the card
+void worked_before_add(const char *call, int band);
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+# Convert the decode archive copied off the SD card to WSJT-X ALL.TXT lines,
+# the same lines archive_dump() prints. Usage:
+#
+#   python3 scripts/all_txt.py ARCHIVE/20260112.DEC [...] >> ALL.TXT
+#
+# The record layout is Archive_Record in include/decode_archive.h, the
+# unpacking follows src/unpack.cpp. Hashed calls keep all the digits of the
+# hash, the radio cuts off the last one.
+
+import struct
+import sys
+import time
+
+RECORD = struct.Struct("<IHHhbB10s2x")
+
+NTOKENS = 2063592
+MAX22 = 4194304
+MAXGRID4 = 32400
+
+
+def charn(c, table):
+    if table not in (2, 3):
+        if c == 0:
+            return " "
+        c -= 1
+    if table != 4:
+        if c < 10:
+            return chr(ord("0") + c)
+        c -= 10
+    if table != 3:
+        if c < 26:
+            return chr(ord("A") + c)
+        c -= 26
+    if table == 0 and c < 5:
+        return "+-./?"[c]
+    if table == 5 and c == 0:
+        return "/"
+    return "_"
+
+
+def unpack28(n28, ip, i3):
+    if n28 < NTOKENS:
+        if n28 <= 2:
+            return ("DE", "QRZ", "CQ")[n28]
+        if n28 <= 1002:
+            return "CQ +%03d" % (n28 - 3)
+        if n28 <= 532443:
+            n = n28 - 1003
+            aaaa = ""
+            for _ in range(4):
+                aaaa = charn(n % 27, 4) + aaaa
+                n //= 27
+            return "CQ " + aaaa.strip()
+        return None
+
+    n28 -= NTOKENS
+    if n28 < MAX22:
+        return "<+%07d>" % n28
+
+    n = n28 - MAX22
+    call = ""
+    for radix, table in ((27, 4), (27, 4), (27, 4), (10, 3), (36, 2), (37, 1)):
+        call = charn(n % radix, table) + call
+        n //= radix
+    call = call.strip()
+    if not call:
+        return None
+    if ip:
+        call += "/R" if i3 == 1 else "/P" if i3 == 2 else ""
+    return call
+
+
+def unpack_type1(bits, i3):
+    n28a = (bits >> 48) & 0x1FFFFFFF
+    n28b = (bits >> 19) & 0x1FFFFFFF
+    ir = (bits >> 18) & 1
+    igrid4 = (bits >> 3) & 0x7FFF
+
+    call1 = unpack28(n28a >> 1, n28a & 1, i3)
+    call2 = unpack28(n28b >> 1, n28b & 1, i3)
+    if call1 is None or call2 is None:
+        return None
+
+    if igrid4 <= MAXGRID4:
+        n = igrid4
+        grid = chr(ord("A") + n // 1800) + chr(ord("A") + n // 100 % 18) + "%d%d" % (n // 10 % 10, n % 10)
+        extra = ("R " if ir else "") + grid
+    else:
+        irpt = igrid4 - MAXGRID4
+        if irpt >= 5:
+            extra = ("R" if ir else "") + "%+03d" % (irpt - 35)
+        else:
+            extra = ("", "", "RRR", "RR73", "73")[irpt]
+    return "%s %s %s" % (call1, call2, extra)
+
+
+def unpack_text(bits):
+    n = bits >> 6  # the 71 bits before n3 and i3
+    text = ""
+    for _ in range(13):
+        text = charn(n % 42, 0) + text
+        n //= 42
+    return text.strip()
+
+
+def unpack_nonstandard(bits):
+    n12 = (bits >> 65) & 0xFFF
+    n58 = (bits >> 7) & ((1 << 58) - 1)
+    iflip = (bits >> 6) & 1
+    nrpt = (bits >> 4) & 3
+    icq = (bits >> 3) & 1
+
+    c11 = ""
+    for _ in range(11):
+        c11 = charn(n58 % 38, 5) + c11
+        n58 //= 38
+    c11 = c11.strip()
+    hashed = "<+%04d>" % n12
+
+    call1, call2 = (c11, hashed) if iflip else (hashed, c11)
+    if icq:
+        return "CQ %s " % call2
+    return "%s %s %s" % (call1, call2, ("RRR", "RR73", "73", "RR")[nrpt])
+
+
+def unpack77(payload):
+    bits = int.from_bytes(payload, "big") >> 3  # 77 bits, MSB first
+    i3 = bits & 7
+    n3 = (bits >> 3) & 7
+
+    if i3 == 0 and n3 == 0:
+        return unpack_text(bits)
+    if i3 == 0 and n3 == 5:
+        return "%018X" % ((bits >> 6) & ((1 << 71) - 1))
+    if i3 in (1, 2):
+        return unpack_type1(bits, i3)
+    if i3 == 4:
+        return unpack_nonstandard(bits)
+    return None
+
+
+def convert(path, out):
+    with open(path, "rb") as archive:
+        data = archive.read()
+
+    # A record cut short by a power loss is left out
+    for offset in range(0, len(data) - RECORD.size + 1, RECORD.size):
+        slot_time, dial_khz, freq_hz, dt_ms, snr, flags, payload = RECORD.unpack_from(data, offset)
+        message = unpack77(payload)
+        if message is None:
+            message = "<unpack failed>"
+        out.write("%s %6d.%03d Rx FT8 %6d %4.1f %4u %s\n" % (
+            time.strftime("%y%m%d_%H%M%S", time.gmtime(slot_time)),
+            dial_khz // 1000, dial_khz % 1000, snr, dt_ms / 1000.0, freq_hz, message))
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit("usage: all_txt.py YYYYMMDD.DEC [...]")
+    for path in sys.argv[1:]:
+        convert(path, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
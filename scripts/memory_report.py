@@ -0,0 +1,71 @@
+from os.path import basename
+import subprocess
+
+Import("env")
+
+# Teensy 4.1 memory regions by address. ITCM code and DTCM data share the
+# 512 kB of RAM1 in 32 kB banks, whatever DTCM leaves over is the stack.
+REGIONS = [
+    ("ITCM", 0x00000000, 0x00080000),
+    ("DTCM", 0x20000000, 0x20080000),
+    ("RAM2", 0x20200000, 0x20280000),
+    ("FLASH", 0x60000000, 0x60800000),
+    ("PSRAM", 0x70000000, 0x71000000),
+]
+
+RAM1_SIZE = 512 * 1024
+BANK_SIZE = 32 * 1024
+TOP_SYMBOLS = 8
+
+
+def region_of(address):
+    for name, start, end in REGIONS:
+        if start <= address < end:
+            return name
+    return None
+
+
+def read_symbols(nm, elf):
+    output = subprocess.check_output([nm, "-S", "-C", "--size-sort", elf], universal_newlines=True)
+    symbols = []
+    for line in output.splitlines():
+        fields = line.split(None, 3)
+        if len(fields) < 4:
+            continue
+        address, size, kind, name = fields
+        region = region_of(int(address, 16))
+        if region:
+            symbols.append((region, int(size, 16), kind, name))
+    return symbols
+
+
+def memory_report(target, source, env):
+    elf = str(target[0])
+    nm = env.subst("$CC").replace("gcc", "nm")
+    symbols = read_symbols(nm, elf)
+
+    totals = {}
+    for region, size, _, _ in symbols:
+        totals[region] = totals.get(region, 0) + size
+
+    print("\nMemory budget for %s" % basename(elf))
+    for name, _, _ in REGIONS:
+        if name in totals:
+            print("  %-6s %8.1f kB" % (name, totals[name] / 1024.0))
+
+    itcm = totals.get("ITCM", 0)
+    itcm_banks = (itcm + BANK_SIZE - 1) // BANK_SIZE
+    stack = RAM1_SIZE - itcm_banks * BANK_SIZE - totals.get("DTCM", 0)
+    print("  stack  %8.1f kB left in RAM1 after %d ITCM banks" % (stack / 1024.0, itcm_banks))
+
+    for name in ("DTCM", "RAM2", "PSRAM"):
+        largest = [s for s in symbols if s[0] == name][-TOP_SYMBOLS:]
+        if not largest:
+            continue
+        print("  largest in %s:" % name)
+        for _, size, _, symbol in reversed(largest):
+            print("    %8d  %s" % (size, symbol))
+    print("")
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", memory_report)
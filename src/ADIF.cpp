@@ -26,6 +26,11 @@
 #include "main.h"
 #include "Maps.h"
 #include "Geodesy.h"
+#include "profile.h"
+#include "trace.h"
+#include "worked_before.h"
+#include "memory_map.h"
+#include "log_writer.h"
 
 static const double EARTH_RAD = 6371; // radius in km
 
@@ -57,7 +62,8 @@ static int16_t map_center_y;
 
 static char map_locator[7];
 static int map_key_index = 0;
-static Map_Memory stored_log_entries[100] = {0};
+#define MAX_MAP_ENTRIES 500
+static BULK_RAM Map_Memory stored_log_entries[MAX_MAP_ENTRIES]; // most recent, only read below number_logged
 static int number_logged = 0;
 static float Station_Latitude, Station_Longitude;
 static float Map_Latitude, Map_Longitude;
@@ -99,9 +105,7 @@ void make_File_Name(void)
 
 static void write_log_data(char *data)
 {
-  Log_File = SD.open(file_name_string, FILE_WRITE);
-  Log_File.println(data);
-  Log_File.close();
+  log_writer_append(file_name_string, data);
 }
 
 void Open_Log_File(void)
@@ -292,6 +296,7 @@ static unsigned num_chars(const char *ptr)
 
 void write_ADIF_Log()
 {
+  PROFILE_SCOPE(PROFILE_WRITE_ADIF_LOG);
   static char log_line[300];
   char freq[10];
 
@@ -324,22 +329,29 @@ void write_ADIF_Log()
   log_line[sizeof(log_line) - 1] = 0;
 
   write_log_data(log_line);
-  if (Auto_QSO) store_logged_CQ_Call(Target_Call);
+  worked_before_add(Target_Call, BandIndex);
+  if (Auto_QSO) store_logged_CQ_Call();
+
+  add_map_entry(Target_Locator);
+}
 
-  LatLong ll = QRAtoLatLong(Target_Locator);
+void add_map_entry(const char *locator)
+{
+  LatLong ll = QRAtoLatLong(locator);
   if (ll.isValid)
-    ADIF_distance = Target_Distance(Target_Locator);
+    ADIF_distance = Target_Distance(locator);
   else
     ADIF_distance = 0;
 
   if (ADIF_distance > 0)
   {
-    ADIF_map_distance = Map_Distance(Target_Locator);
-    ADIF_map_bearing = Map_Bearing(Target_Locator);
+    ADIF_map_distance = Map_Distance(locator);
+    ADIF_map_bearing = Map_Bearing(locator);
 
     draw_vector(ADIF_map_distance, ADIF_map_bearing, 3, 3);
-    stored_log_entries[number_logged].ADIF_map_distance = ADIF_map_distance;
-    stored_log_entries[number_logged].ADIF_map_bearing = ADIF_map_bearing;
+    Map_Memory *entry = &stored_log_entries[number_logged % MAX_MAP_ENTRIES];
+    strncpy(entry->locator, locator, sizeof(entry->locator) - 1);
+    entry->locator[sizeof(entry->locator) - 1] = 0;
     number_logged++;
   }
 }
@@ -369,12 +381,17 @@ static void drawImage(uint16_t image_width, uint16_t image_height, uint16_t imag
 
 static void draw_stored_entries(void)
 {
-  for (int j = 0; j < number_logged && j < (int)(sizeof(stored_log_entries) / sizeof(stored_log_entries[0])); j++)
-    draw_vector(stored_log_entries[j].ADIF_map_distance, stored_log_entries[j].ADIF_map_bearing, 3, 3);
+  for (int j = 0; j < number_logged && j < MAX_MAP_ENTRIES; j++)
+  {
+    const char *locator = stored_log_entries[j].locator;
+    draw_vector(Map_Distance(locator), Map_Bearing(locator), 3, 3);
+  }
 }
 
 void draw_map(int16_t index)
 {
+  PROFILE_SCOPE(PROFILE_DRAW_MAP);
+  TRACE_SCOPE(TRACE_DISPLAY);
   map_width = MapFiles[index].map_width;
   map_height = MapFiles[index].map_height;
   map_center_x = MapFiles[index].map_center_x;
@@ -42,114 +42,64 @@ static void copy_and_trim(char *dest, const char *src, size_t len)
     str_trim(dest);
 }
 
-void parse_ini(const char *buffer, size_t buffer_len, ini_data_t *ini_data)
+static void parse_line(char *line, char *section, ini_handler_t handler, void *user)
 {
-    ini_data->num_sections = 0;
-    int current_section = -1;
-    const char *current_pos = buffer;
-    const char *buffer_end = buffer + buffer_len;
+    str_trim(line);
+    size_t length = strlen(line);
 
-    while (current_pos < buffer_end)
+    // Handle comments
+    if (*line == ';' || *line == '#' || length == 0)
     {
-        const char *line_start = current_pos;
-        while (current_pos < buffer_end && *current_pos != '\n')
-        {
-            current_pos++;
-        }
-
-        char line[MAX_LINE_LENGTH];
-        copy_and_trim(line, line_start, min((size_t)(current_pos - line_start), sizeof(line) - 1));
-
-        // Handle comments
-        if (*line == ';' || *line == '#' || strlen(line) == 0)
-        {
-            // Skip comment or empty line
-        }
-        else if (*line == '[' && line[strlen(line) - 1] == ']')
-        {
-            // Handle section
-            if (ini_data->num_sections < MAX_SECTIONS)
-            {
-                current_section = ini_data->num_sections;
-                ini_section_t *section = &ini_data->sections[current_section];
-
-                section->num_entries = 0;
-                section->present = true;
-
-                copy_and_trim(section->name, line + 1, min(strlen(line) - 2, sizeof(section->name) - 1));
-                ini_data->num_sections++;
-            }
-            else
-            {
-                current_section = -1; // Too many sections
-            }
-        }
-        else if (current_section != -1)
+        // Skip comment or empty line
+    }
+    else if (*line == '[' && line[length - 1] == ']')
+    {
+        // Handle section
+        copy_and_trim(section, line + 1, min(length - 2, (size_t)MAX_SECTION_NAME_LENGTH - 1));
+    }
+    else if (*section != 0)
+    {
+        // Handle key-value pair
+        char *equals_pos = strchr(line, '=');
+        if (equals_pos != NULL)
         {
-            // Handle key-value pair
-            const char *equals_pos = NULL;
-            for (size_t i = 0; i < strlen(line); i++)
-            {
-                if (line[i] == '=')
-                {
-                    equals_pos = line + i;
-                    break;
-                }
-            }
+            char key[MAX_KEY_LENGTH];
+            char value[MAX_VALUE_LENGTH];
 
-            ini_section_t *current_section_ptr = &ini_data->sections[current_section];
-            if (equals_pos != NULL && current_section_ptr->num_entries < MAX_KEYS_PER_SECTION)
-            {
-                ini_entry_t *entry = &current_section_ptr->entries[ini_data->sections[current_section].num_entries++];
-
-                copy_and_trim(entry->key, line, min((size_t)(equals_pos - line), sizeof(entry->key) - 1));
-                copy_and_trim(entry->value, equals_pos + 1, min((size_t)(buffer_end - equals_pos + 1), sizeof(entry->value) - 1));
-
-                entry->present = true;
-            }
-        }
+            copy_and_trim(key, line, min((size_t)(equals_pos - line), sizeof(key) - 1));
+            copy_and_trim(value, equals_pos + 1, min(strlen(equals_pos + 1), sizeof(value) - 1));
 
-        // Move to the next line
-        if (current_pos < buffer_end && *current_pos == '\n')
-        {
-            current_pos++;
+            handler(section, key, value, user);
         }
     }
 }
 
-const char *get_ini_value(const ini_data_t *ini_data, const char *section_name, const char *entry_key)
+void parse_ini(ini_reader_t reader, void *source, ini_handler_t handler, void *user)
 {
-    for (unsigned int i = 0; i < ini_data->num_sections; i++)
-    {
-        const ini_section_t *section = ini_data->sections + i;
-        if (section->present && strcmp(section->name, section_name) == 0)
-        {
-            return get_ini_value_from_section(section, entry_key);
-        }
-    }
-    return NULL;
-}
+    char section[MAX_SECTION_NAME_LENGTH] = {0};
+    char line[MAX_LINE_LENGTH];
+    char chunk[64];
+    size_t line_len = 0;
+    size_t chunk_len;
 
-const ini_section_t *get_ini_section(const ini_data_t *ini_data, const char *section_name)
-{
-    for (unsigned int i = 0; i < ini_data->num_sections; i++)
+    while ((chunk_len = reader(chunk, sizeof(chunk), source)) > 0)
     {
-        const ini_section_t *section = ini_data->sections + i;
-        if (section->present && strcmp(section->name, section_name) == 0)
+        for (size_t i = 0; i < chunk_len; i++)
         {
-            return section;
+            if (chunk[i] == '\n')
+            {
+                line[line_len] = 0;
+                parse_line(line, section, handler, user);
+                line_len = 0;
+            }
+            else if (line_len < sizeof(line) - 1)
+            {
+                line[line_len++] = chunk[i];
+            }
         }
     }
-    return NULL;
-}
 
-const char *get_ini_value_from_section(const ini_section_t *section, const char *entry_key)
-{
-    for (unsigned int j = 0; j < section->num_entries; j++)
-    {
-        const ini_entry_t *entry = section->entries + j;
-        if (entry->present && strcmp(entry->key, entry_key) == 0)
-            return entry->value;
-    }
-    return NULL;
+    // Last line without a newline
+    line[line_len] = 0;
+    parse_line(line, section, handler, user);
 }
@@ -11,6 +11,9 @@
 #include "traffic_manager.h"
 #include "button.h"
 #include "main.h"
+#include "profile.h"
+#include "trace.h"
+#include "memory_map.h"
 
 static float window[FFT_SIZE];
 
@@ -22,8 +25,30 @@ static float mag_db[FFT_BASE_SIZE + 1];
 static arm_rfft_instance_q15 fft_inst;
 static float raw_fft_max;
 
-static const size_t export_fft_power_size = ft8_msg_samples * ft8_buffer * 4;
-uint8_t export_fft_power[export_fft_power_size];
+static const size_t ft8_block_size = ft8_buffer * 4;
+static const size_t export_fft_power_size = ft8_ring_blocks * ft8_block_size;
+BULK_RAM uint8_t export_fft_power[export_fft_power_size]; // ~190 kB, kept out of DTCM
+
+// Block n of the spectrogram lives at ring position n % ft8_ring_blocks.
+// Start one lap in so that the first windows index the zeroed history.
+static uint32_t spectrogram_head = ft8_ring_blocks; // blocks written so far
+static uint32_t slot_start_block = ft8_ring_blocks; // block index of the current slot start
+uint32_t decode_start_block;                         // first block of the window being decoded
+DT_Epoch decode_epoch;
+static DT_Epoch slot_epoch; // timing of the current slot
+
+struct Decode_Window
+{
+  uint32_t start_block;
+  DT_Epoch epoch;
+};
+
+// Windows waiting for the decoder, oldest first. One can be held back by TX
+// while the next slot ends, a third pushes the oldest out.
+#define DECODE_QUEUE 2
+static Decode_Window decode_queue[DECODE_QUEUE];
+static int decode_queued = 0;
+static uint32_t decode_windows_skipped = 0;
 
 
 static float ft_blackman_i(int i, int N)
@@ -41,6 +66,7 @@ static float ft_blackman_i(int i, int N)
 void init_DSP(void)
 {
   arm_rfft_init_q15(&fft_inst, FFT_SIZE, 0, 1);
+  memset(export_fft_power, 0, sizeof(export_fft_power)); // RAM2 is not zeroed at reset
   for (int i = 0; i < FFT_SIZE; ++i)
   {
     window[i] = ft_blackman_i(i, FFT_SIZE);
@@ -50,6 +76,7 @@ void init_DSP(void)
 // Compute FFT magnitudes (log power) for each timeslot in the signal
 static void extract_power(size_t offset)
 {
+  PROFILE_SCOPE(PROFILE_EXTRACT_POWER);
   int half_gulp = 0;
   for (int time_sub = 0; time_sub < 2; ++time_sub)
   {
@@ -102,6 +129,7 @@ static int noise_free_sets_count = 0;
 
 static void update_offset_waterfall(int offset)
 {
+  PROFILE_SCOPE(PROFILE_WATERFALL);
   uint8_t WF_index[ft8_buffer];
 
   for (int x = ft8_min_bin; x < ft8_buffer; x++)
@@ -168,19 +196,88 @@ static void update_offset_waterfall(int offset)
 
 void process_FT8_FFT(void)
 {
-  const int offset_step = ft8_buffer * 4;
+  TRACE_SCOPE(TRACE_FFT);
+  int master_offset = (spectrogram_head % ft8_ring_blocks) * ft8_block_size;
+  extract_power(master_offset);
+  ++spectrogram_head;
 
-  if (ft8_flag)
-  {
-    int master_offset = offset_step * FT_8_counter;
-    extract_power(master_offset);
+  FT_8_counter = spectrogram_head - slot_start_block;
 
+  // The waterfall only has room for one slot
+  if (WF_counter < ft8_msg_samples)
     update_offset_waterfall(master_offset);
 
-    if (++FT_8_counter == ft8_msg_samples)
+  if (ft8_flag && FT_8_counter >= ft8_msg_samples + ft8_late_blocks)
+  {
+    queue_FT8_decode();
+  }
+}
+
+// Start a new slot at the current spectrogram block, nothing is cleared
+void mark_slot_start(void)
+{
+  slot_start_block = spectrogram_head;
+  slot_epoch = dt_epoch();
+  FT_8_counter = 0;
+}
+
+static void skip_decode_window(void)
+{
+  decode_windows_skipped++;
+  Serial.printf("Decode of a slot skipped, %lu so far\n", (unsigned long)decode_windows_skipped);
+}
+
+// Hand the most recent ft8_decode_blocks blocks over to the decoder
+void queue_FT8_decode(void)
+{
+  if (decode_queued == DECODE_QUEUE)
+  {
+    skip_decode_window();
+    decode_queue[0] = decode_queue[1];
+    decode_queued--;
+  }
+
+  decode_queue[decode_queued].start_block = spectrogram_head - ft8_decode_blocks;
+  decode_queue[decode_queued].epoch = slot_epoch;
+  decode_queued++;
+  ft8_flag = 0;
+  decode_flag = 1;
+}
+
+// The FFT keeps running while the decode is in progress, it has
+// ft8_ring_blocks - ft8_decode_blocks blocks before it reaches the window
+static bool window_valid(uint32_t start_block)
+{
+  return spectrogram_head - start_block <= ft8_ring_blocks;
+}
+
+bool decode_window_valid(void)
+{
+  return window_valid(decode_start_block);
+}
+
+// Take the oldest queued window the FFT has not yet written over, the ones
+// it has are given up on and counted
+bool take_FT8_decode(void)
+{
+  while (decode_queued > 0)
+  {
+    Decode_Window window = decode_queue[0];
+    decode_queue[0] = decode_queue[1];
+    decode_queued--;
+
+    if (window_valid(window.start_block))
     {
-      ft8_flag = 0;
-      decode_flag = 1;
+      decode_start_block = window.start_block;
+      decode_epoch = window.epoch;
+      return true;
     }
+    skip_decode_window();
   }
+  return false;
+}
+
+bool FT8_decode_queued(void)
+{
+  return decode_queued > 0;
 }
@@ -12,12 +12,19 @@
 
 #include "main.h"
 #include "PskInterface.h"
+#include "trace.h"
 
 static const int MAX_SYNCTIME_RETRIES = 10;
+static const int MAX_LINK_FAILURES = 3;
+static const uint32_t LINK_RETRY_MS = 30000; // quiet period after the ESP32 stops answering
+static const uint32_t I2C_TIMEOUT_MS = 5;     // longest transaction before it counts as a failure
+static const uint8_t I2C_TIMED_OUT = 5;       // the endTransmission() code AVR Wire uses for a timeout
+static const int SPOT_QUEUE_SIZE = 64;
 
 static bool syncTime = true;
 static int syncTimeCounter = 0;
 static bool senderSent = false;
+static bool softwareSent = false;
 
 struct RTC_Time
 {
@@ -39,165 +46,249 @@ enum I2COperation
   OP_SEND_REQUEST
 };
 
+enum TimeState
+{
+  TIME_IDLE = 0,
+  TIME_WANTED, // OP_TIME_REQUEST is due
+  TIME_READ    // the request went out, the reply is read on the next step
+};
+
+struct Spot
+{
+  char callsign[14];
+  uint8_t snr;
+  uint32_t frequency;
+};
+
 static const uint8_t ESP32_I2C_ADDRESS = 0x2A;
 
+static TimeState timeState = TIME_IDLE;
+static Spot spotQueue[SPOT_QUEUE_SIZE];
+static int spotHead = 0;
+static int spotCount = 0;
+static uint32_t spotsDropped = 0;
+static int linkFailures = 0;
+static bool linkDown = false;
+static uint32_t linkDownTime = 0;
+
 void requestTimeSync(void)
 {
   syncTime = true;
   // also cause the sender record to be sent again
   senderSent = false;
+  softwareSent = false;
   syncTimeCounter = 0;
+  linkDown = false;
+  linkFailures = 0;
 }
 
 void getTime(void)
 {
-  if (syncTime && syncTimeCounter++ < MAX_SYNCTIME_RETRIES)
+  if (syncTime && timeState == TIME_IDLE && syncTimeCounter++ < MAX_SYNCTIME_RETRIES)
+    timeState = TIME_WANTED;
+}
+
+void pskBegin(void)
+{
+  Wire1.begin();
+  // Bounds the reads of a reply, the Teensy library has no setting for the
+  // transaction itself so writeMessage() times that
+  Wire1.setTimeout(I2C_TIMEOUT_MS);
+}
+
+// A failure counts against the link and enough of them in a row leave it
+// alone for LINK_RETRY_MS
+static bool linkResult(uint8_t retVal)
+{
+  if (retVal == 0)
+  {
+    linkFailures = 0;
+    return true;
+  }
+
+  if (++linkFailures >= MAX_LINK_FAILURES)
   {
-    Wire1.beginTransmission(ESP32_I2C_ADDRESS);
-    uint8_t retVal = Wire1.endTransmission();
-    if (retVal == 0)
-    {
-      RTC_Time rtcTime;
-      memset(&rtcTime, 0, sizeof(rtcTime));
-
-      Wire1.beginTransmission(ESP32_I2C_ADDRESS);
-      Wire1.write(OP_TIME_REQUEST);
-      Wire1.endTransmission();
-      Wire1.requestFrom(ESP32_I2C_ADDRESS, sizeof(RTC_Time));
-      uint8_t *ptr = (uint8_t *)&rtcTime;
-      size_t size = 0;
-      for (;;)
-      {
-        if (Wire1.available())
-        {
-          ptr[size++] = Wire1.read();
-          if (size >= sizeof(RTC_Time))
-            break;
-        }
-      }
-
-      if (rtcTime.year > 24 && rtcTime.year < 99 && size == sizeof(RTC_Time))
-      {
-        syncTime = false;
-
-        Serial.printf("%u %2.2u:%2.2u:%2.2u %2.2u/%2.2u/%2.2u (%u)\n",
-                      size,
-                      rtcTime.hours, rtcTime.minutes, rtcTime.seconds,
-                      rtcTime.day, rtcTime.month, rtcTime.year,
-                      rtcTime.dayOfWeek);
-        setTime(rtcTime.hours,
-                rtcTime.minutes,
-                rtcTime.seconds,
-                rtcTime.day,
-                rtcTime.month,
-                rtcTime.year + 2000);
-        Teensy3Clock.set(now()); // set the RTC
-      }
-    }
-    else
-    {
-      Serial.printf("Failed to read RTC time: %u\n", retVal);
-      syncTime = false;
-    }
+    Serial.printf("PSK link down: %u\n", retVal);
+    linkDown = true;
+    linkDownTime = millis();
+    linkFailures = 0;
   }
+  return false;
 }
 
-bool addSenderRecord(const char *callsign, const char *gridSquare, const char *software)
+// Every transaction is a single write, one that stalls the loop for longer
+// than I2C_TIMEOUT_MS fails even when it got through
+static bool writeMessage(const uint8_t *buffer, size_t length)
 {
-  bool result = false;
+  uint32_t start = millis();
   Wire1.beginTransmission(ESP32_I2C_ADDRESS);
+  Wire1.write(buffer, length);
   uint8_t retVal = Wire1.endTransmission();
-  if (retVal == 0)
+  if (retVal == 0 && millis() - start > I2C_TIMEOUT_MS)
+    retVal = I2C_TIMED_OUT;
+  return linkResult(retVal);
+}
+
+// Append a length-delimited string, false if it does not fit
+static bool putString(uint8_t *&ptr, const uint8_t *end, const char *text)
+{
+  size_t length = strlen(text);
+  if (ptr + 1 + length > end)
+    return false;
+  *ptr++ = (uint8_t)length;
+  memcpy(ptr, text, length);
+  ptr += length;
+  return true;
+}
+
+static void requestTime(void)
+{
+  uint8_t operation = OP_TIME_REQUEST;
+  if (writeMessage(&operation, 1))
+  {
+    timeState = TIME_READ;
+  }
+  else
+  {
+    Serial.println("Failed to request RTC time");
+    timeState = TIME_IDLE;
+    syncTime = false;
+  }
+}
+
+static void readTime(void)
+{
+  timeState = TIME_IDLE;
+
+  RTC_Time rtcTime;
+  memset(&rtcTime, 0, sizeof(rtcTime));
+
+  // readBytes() gives up after I2C_TIMEOUT_MS, a short reply waits for the
+  // next slot and counts against the link
+  Wire1.requestFrom(ESP32_I2C_ADDRESS, sizeof(RTC_Time));
+  size_t size = Wire1.readBytes((char *)&rtcTime, sizeof(RTC_Time));
+  if (!linkResult(size == sizeof(RTC_Time) ? 0 : I2C_TIMED_OUT))
+    return;
+
+  if (rtcTime.year > 24 && rtcTime.year < 99)
+  {
+    syncTime = false;
+
+    Serial.printf("%u %2.2u:%2.2u:%2.2u %2.2u/%2.2u/%2.2u (%u)\n",
+                  size,
+                  rtcTime.hours, rtcTime.minutes, rtcTime.seconds,
+                  rtcTime.day, rtcTime.month, rtcTime.year,
+                  rtcTime.dayOfWeek);
+    setTime(rtcTime.hours,
+            rtcTime.minutes,
+            rtcTime.seconds,
+            rtcTime.day,
+            rtcTime.month,
+            rtcTime.year + 2000);
+    Teensy3Clock.set(now()); // set the RTC
+  }
+}
+
+static void sendSenderRecord(void)
+{
+  uint8_t buffer[32];
+  uint8_t *ptr = buffer;
+  *ptr++ = (uint8_t)OP_SENDER_RECORD;
+  if (!putString(ptr, buffer + sizeof(buffer), Station_Call) ||
+      !putString(ptr, buffer + sizeof(buffer), Station_Locator))
+  {
+    senderSent = true; // can never be sent
+    return;
+  }
+  senderSent = writeMessage(buffer, ptr - buffer);
+}
+
+static void sendSoftwareRecord(void)
+{
+  uint8_t buffer[32];
+  uint8_t *ptr = buffer;
+  *ptr++ = (uint8_t)OP_SENDER_SOFTWARE_RECORD;
+  if (!putString(ptr, buffer + sizeof(buffer), "DX FT8 Transceiver"))
+  {
+    softwareSent = true;
+    return;
+  }
+  softwareSent = writeMessage(buffer, ptr - buffer);
+}
+
+static void sendSpot(void)
+{
+  const Spot *spot = &spotQueue[spotHead];
+
+  uint8_t buffer[32];
+  uint8_t *ptr = buffer;
+  *ptr++ = (uint8_t)OP_RECEIVER_RECORD;
+  if (putString(ptr, buffer + sizeof(buffer) - sizeof(uint32_t) - sizeof(uint8_t), spot->callsign))
   {
-    uint8_t buffer[32];
-    size_t callsignLength = strlen(callsign);
-    size_t gridSquareLength = strlen(gridSquare);
-
-    size_t bufferSize = sizeof(uint8_t) + sizeof(uint8_t) + callsignLength + sizeof(uint8_t) + gridSquareLength;
-    if (bufferSize < sizeof(buffer))
-    {
-      uint8_t *ptr = buffer;
-      *ptr++ = (uint8_t)OP_SENDER_RECORD;
-      // Add callsign as length-delimited
-      *ptr++ = (uint8_t)callsignLength;
-      memcpy(ptr, callsign, callsignLength);
-      ptr += callsignLength;
-
-      // Add gridSquare as length-delimited
-      *ptr++ = (uint8_t)gridSquareLength;
-      memcpy(ptr, gridSquare, gridSquareLength);
-      ptr += gridSquareLength;
-
-      Wire1.beginTransmission(ESP32_I2C_ADDRESS);
-      Wire1.write(buffer, ptr - buffer);
-      result = (Wire1.endTransmission() == 0);
-    }
-
-    if (result)
-    {
-      size_t softwareLength = strlen(software);
-      bufferSize = sizeof(uint8_t) + sizeof(uint8_t) + softwareLength;
-      if (bufferSize < sizeof(buffer))
-      {
-        uint8_t *ptr = buffer;
-        *ptr++ = (uint8_t)OP_SENDER_SOFTWARE_RECORD;
-        // Add software as length-delimited
-        *ptr++ = (uint8_t)softwareLength;
-        memcpy(ptr, software, softwareLength);
-        ptr += softwareLength;
-
-        Wire1.beginTransmission(ESP32_I2C_ADDRESS);
-        Wire1.write(buffer, ptr - buffer);
-        result = (Wire1.endTransmission() == 0);
-      }
-    }
+    // Add frequency
+    memcpy(ptr, &spot->frequency, sizeof(spot->frequency));
+    ptr += sizeof(spot->frequency);
+
+    // Add SNR (1 byte)
+    *ptr++ = spot->snr;
+
+    // Kept at the head of the queue until the ESP32 takes it
+    if (!writeMessage(buffer, ptr - buffer))
+      return;
   }
-  return result;
+
+  spotHead = (spotHead + 1) % SPOT_QUEUE_SIZE;
+  spotCount--;
 }
 
 bool addReceivedRecord(const char *callsign, uint32_t frequency, uint8_t snr)
 {
-  if (!senderSent)
+  // A full queue loses its oldest spot
+  if (spotCount == SPOT_QUEUE_SIZE)
   {
-    addSenderRecord(Station_Call, Station_Locator, "DX FT8 Transceiver");
-    senderSent = true;
+    spotHead = (spotHead + 1) % SPOT_QUEUE_SIZE;
+    spotCount--;
+    spotsDropped++;
   }
 
-  bool result = false;
-  Wire1.beginTransmission(ESP32_I2C_ADDRESS);
-  uint8_t retVal = Wire1.endTransmission();
-  if (retVal == 0)
+  Spot *spot = &spotQueue[(spotHead + spotCount) % SPOT_QUEUE_SIZE];
+  strncpy(spot->callsign, callsign, sizeof(spot->callsign) - 1);
+  spot->callsign[sizeof(spot->callsign) - 1] = 0;
+  spot->frequency = frequency;
+  spot->snr = snr;
+  spotCount++;
+  return true;
+}
+
+bool pskPending(void)
+{
+  if (linkDown)
   {
-    uint8_t buffer[32];
-    size_t callsignLength = strlen(callsign);
-    size_t bufferSize = sizeof(uint8_t) + sizeof(uint8_t) + callsignLength + sizeof(uint32_t) + sizeof(uint8_t);
-    if (bufferSize < sizeof(buffer))
-    {
-      uint8_t *ptr = buffer;
-      *ptr++ = (uint8_t)OP_RECEIVER_RECORD;
-      // Add callsign as length-delimited
-      *ptr++ = (uint8_t)callsignLength;
-      memcpy(ptr, callsign, callsignLength);
-      ptr += callsignLength;
-
-      // Add frequency
-      memcpy(ptr, &frequency, sizeof(frequency));
-      ptr += (uint8_t)sizeof(frequency);
-
-      // Add SNR (1 byte)
-      *ptr++ = snr;
-
-      Wire1.beginTransmission(ESP32_I2C_ADDRESS);
-      Wire1.write(buffer, ptr - buffer);
-      result = (Wire1.endTransmission() == 0);
-    }
+    if (millis() - linkDownTime < LINK_RETRY_MS)
+      return false;
+    linkDown = false;
   }
-  return result;
+  return timeState != TIME_IDLE || spotCount > 0;
+}
+
+void pskStep(void)
+{
+  TRACE_SCOPE(TRACE_I2C);
+  if (timeState == TIME_WANTED)
+    requestTime();
+  else if (timeState == TIME_READ)
+    readTime();
+  else if (!senderSent)
+    sendSenderRecord();
+  else if (!softwareSent)
+    sendSoftwareRecord();
+  else if (spotCount > 0)
+    sendSpot();
 }
 
 bool sendRequest(void)
 {
-  Wire1.beginTransmission(ESP32_I2C_ADDRESS);
-  Wire1.write(OP_SEND_REQUEST);
-  return (Wire1.endTransmission() == 0);
+  TRACE_SCOPE(TRACE_I2C);
+  uint8_t operation = OP_SEND_REQUEST;
+  return writeMessage(&operation, 1);
 }
@@ -29,6 +29,18 @@
 #include "PskInterface.h"
 #include "autoseq_engine.h"
 #include "ADIF.h"
+#include "dt_estimator.h"
+#include "tx_scheduler.h"
+#include "touch_queue.h"
+#include "task_scheduler.h"
+#include "profile.h"
+#include "trace.h"
+#include "memory_map.h"
+#include "worked_before.h"
+#include "log_import.h"
+#include "log_writer.h"
+#include "decode_archive.h"
+#include "audio_recorder.h"
 
 #define SCREEN_WIDTH 1024
 #define SCREEN_HEIGHT 600
@@ -37,8 +49,6 @@
 #define BACKLITE 6 // My copy of the display is set for external backlight control
 #define CTP_INT 27 // Use an interrupt capable pin such as pin 2 (any pin on a Teensy)
 
-#define MAXTOUCHLIMIT 10
-
 // Used for skipping the TX slot
 int was_txing = 0;
 bool clr_pressed = false;
@@ -105,7 +115,6 @@ int ft8_marker;
 int decode_flag;
 int WF_counter;
 int xmit_flag;
-int ft8_xmit_counter;
 int DSP_Flag;
 int master_decoded;
 
@@ -119,8 +128,12 @@ int QSO_xmit;
 int slot_state = 0;
 int target_slot;
 
+// start_time correction from the decoded DT statistics, applied mid slot
+static int pending_dt_correction = 0;
+
 static void process_data();
 static void update_synchronization();
+static void process_serial_command();
 
 // Helper function for updating TX region display
 void tx_display_update(void)
@@ -142,8 +155,256 @@ void tx_display_update(void)
   display_qso_state(autoseq_state_str);
 }
 
+// Hands the radio back to receive once the symbol clock has sent the last tone
+static bool tx_end_ready(void)
+{
+  return xmit_flag && !Tune_On && tx_scheduler_finished();
+}
+
+static void tx_end_task(void)
+{
+  xmit_flag = 0;
+  terminate_transmit_armed();
+}
+
+static bool audio_ready(void)
+{
+  return audioQueue.available() >= num_que_blocks;
+}
+
+static bool fft_ready(void)
+{
+  return DSP_Flag;
+}
+
+static bool clock_due = false;
+
+static void fft_task(void)
+{
+  process_FT8_FFT();
+  DSP_Flag = 0;
+  clock_due = true;
+}
+
+static bool decode_started = false;
+static bool results_due = false;
+
+// A decode that has started runs to the end. TX holds off a new one, and so
+// do the results of the last one until they are shown
+static bool decode_ready(void)
+{
+  return decode_flag && !Tune_On && (decode_started || (!xmit_flag && !results_due));
+}
+
+// One step of the decode per call, so that audio and FFT run in between
+static void decode_task(void)
+{
+  if (!decode_started)
+  {
+    if (!take_FT8_decode())
+    {
+      decode_flag = 0;
+      return;
+    }
+    ft8_decode_begin();
+    decode_started = true;
+  }
+
+  int decoded = ft8_decode_step();
+  if (decoded < 0)
+    return;
+
+  master_decoded = decoded;
+  decode_started = false;
+  decode_flag = FT8_decode_queued();
+  results_due = true;
+}
+
+static bool results_ready(void)
+{
+  return results_due;
+}
+
+// SD writes wait for a gap between TX and the decode of a slot
+static bool sd_quiet(void)
+{
+  return !xmit_flag && !decode_flag && !results_due;
+}
+
+static bool flush_ready(void)
+{
+  return log_writer_pending() && sd_quiet();
+}
+
+static bool archive_ready(void)
+{
+  return archive_pending() && sd_quiet();
+}
+
+static void results_task(void)
+{
+  results_due = false;
+
+  display_messages(new_decoded, master_decoded);
+
+  for (int i = 0; i < master_decoded; ++i)
+  {
+    if (strindex(new_decoded[i].call_to, Station_Call) >= 0)
+    {
+      char received_message[22];
+      sprintf(received_message, "%s %s %s", new_decoded[i].call_to, new_decoded[i].call_from, new_decoded[i].locator);
+      strcpy(current_message, received_message);
+      update_message_log_display(0);
+    }
+  }
+
+  if (!was_txing)
+  {
+    for (int i = 0; i < master_decoded; i++)
+    {
+      // TX is (potentially) necessary
+      if (autoseq_on_decode(&new_decoded[i]))
+      {
+        // Fetch TX msg
+        if (autoseq_get_next_tx(autoseq_txbuf))
+        {
+          queue_custom_text(autoseq_txbuf);
+          QSO_xmit = 1;
+          tx_display_update();
+          break;
+        }
+      }
+    }
+
+    if (!QSO_xmit)
+    { // Check if QSO_xmit
+      // Check if retry is necessary
+      if (autoseq_get_next_tx(autoseq_txbuf))
+      {
+        queue_custom_text(autoseq_txbuf);
+        QSO_xmit = 1;
+      }
+      else if (Beacon_On)
+      {
+        target_slot = slot_state ^ 1; // toggle the slot
+        autoseq_start_cq();
+        autoseq_get_next_tx(autoseq_txbuf);
+        queue_custom_text(autoseq_txbuf);
+        QSO_xmit = 1;
+        tx_display_update();
+      }
+      else if (Auto_QSO)
+      {
+        // Auto_QSO_Start
+        if (Valid_CQ_Candidate)
+        {
+          process_selected_Station(master_decoded, max_sync_score_index);
+          autoseq_on_touch(&new_decoded[max_sync_score_index]);
+          autoseq_get_next_tx(autoseq_txbuf);
+          queue_custom_text(autoseq_txbuf);
+          QSO_xmit = 1;
+          tx_display_update();
+          store_CQ_Call();
+        }
+      } // Auto_QSO_End
+
+    } // Check if QSO_xmit End
+  }
+}
+
+static bool clear_ready(void)
+{
+  return clr_pressed;
+}
+
+static void clear_task(void)
+{
+  terminate_QSO();
+  QSO_xmit = 0;
+  was_txing = 0;
+  autoseq_init(Station_Call, Short_Station_Locator);
+  autoseq_txbuf[0] = '\0';
+  tx_display_update();
+  clr_pressed = false;
+}
+
+static bool worked_ready(void)
+{
+  return tx_pressed;
+}
+
+static void worked_task(void)
+{
+  worked_qsos_in_display = display_worked_qsos();
+  tx_pressed = false;
+  tx_display_update();
+}
+
+static bool log_ready(void)
+{
+  return !Tune_On && log_display_flag == 1;
+}
+
+static void log_task(void)
+{
+  display_logged_messages();
+  log_display_flag = 0;
+}
+
+static bool select_ready(void)
+{
+  return !Tune_On && FT8_Touch_Flag && FT_8_TouchIndex < master_decoded;
+}
+
+static void select_task(void)
+{
+  process_selected_Station(master_decoded, FT_8_TouchIndex);
+  autoseq_on_touch(&new_decoded[FT_8_TouchIndex]);
+  autoseq_get_next_tx(autoseq_txbuf);
+  queue_custom_text(autoseq_txbuf);
+  QSO_xmit = 1;
+  FT8_Touch_Flag = 0;
+  tx_display_update();
+}
+
+static bool clock_ready(void)
+{
+  return clock_due;
+}
+
+static void clock_task(void)
+{
+  display_time(880, 30);
+  clock_due = false;
+}
+
+// name, class, ready, run, period ms, deadline ms, budget us
+static Task tasks[] = {
+    {"tx_end", TASK_REALTIME, tx_end_ready, tx_end_task, 0, 5, 20000},
+    {"audio", TASK_REALTIME, audio_ready, process_data, 0, 20, 500},
+    {"fft", TASK_REALTIME, fft_ready, fft_task, 0, 40, 5000},
+    {"slot", TASK_REALTIME, NULL, update_synchronization, 5, 5, 2000},
+    {"decode", TASK_BACKGROUND, decode_ready, decode_task, 0, 200, 50000},
+    {"results", TASK_BACKGROUND, results_ready, results_task, 0, 300, 100000},
+    {"touch", TASK_BACKGROUND, NULL, process_touch, 20, 50, 2000},
+    {"select", TASK_BACKGROUND, select_ready, select_task, 0, 100, 50000},
+    {"clear", TASK_BACKGROUND, clear_ready, clear_task, 0, 100, 50000},
+    {"worked", TASK_BACKGROUND, worked_ready, worked_task, 0, 200, 50000},
+    {"log", TASK_BACKGROUND, log_ready, log_task, 0, 500, 50000},
+    {"clock", TASK_BACKGROUND, clock_ready, clock_task, 0, 500, 5000},
+    {"serial", TASK_BACKGROUND, NULL, process_serial_command, 50, 200, 50000},
+    {"import", TASK_BACKGROUND, log_import_pending, log_import_step, 0, 1000, 5000},
+    {"flush", TASK_BACKGROUND, flush_ready, log_writer_flush, 0, 2000, 50000},
+    {"archive", TASK_BACKGROUND, archive_ready, archive_flush, 0, 2000, 20000},
+    // Not held off by sd_quiet(), a recording has to keep up with the audio
+    {"record", TASK_BACKGROUND, recorder_pending, recorder_write, 0, 500, 20000},
+    {"i2c", TASK_BACKGROUND, pskPending, pskStep, 0, 1000, 5000},
+};
+
 void setup(void)
 {
+  memory_begin();
+
   Serial.begin(9600);
 
   if (CrashReport)
@@ -160,7 +421,7 @@ void setup(void)
   delay(10);
 
   Wire.begin();
-  Wire1.begin();
+  pskBegin();
   pinMode(BACKLITE, OUTPUT);
   digitalWrite(BACKLITE, HIGH);
 
@@ -168,7 +429,7 @@ void setup(void)
   tft.backlight(true);
   tft.useCapINT(CTP_INT); // we use the capacitive chip Interrupt out!
   tft.setTouchLimit(MAXTOUCHLIMIT);
-  tft.enableCapISR(true); // capacitive touch screen interrupt it's armed
+  touch_begin(CTP_INT); // touch reports are queued from the controller interrupt
   tft.fillRect(0, 0, 1024, 600, BLACK);
 
   Init_BoardVersionInput();
@@ -209,11 +470,15 @@ void setup(void)
   set_RF_Gain(RF_Gain);
   set_Attenuator_Gain(1.0);
 
+  recorder_begin();
   audioQueue.begin();
 
   start_time = millis();
 
   open_stationData_file();
+  log_writer_begin();
+  archive_begin();
+  bool worked_before_loaded = worked_before_begin();
 
   set_Station_Coordinates();
 
@@ -225,6 +490,7 @@ void setup(void)
   }
 
   display_all_buttons();
+  build_touch_index();
   display_date(650, 30);
   display_station_data(820, 0);
 
@@ -234,158 +500,17 @@ void setup(void)
 
   Init_Log_File();
   draw_map(Map_Index);
+  log_import_begin(!worked_before_loaded);
 
   autoseq_init(Station_Call, Short_Station_Locator);
+
+  tasks_begin(tasks, sizeof(tasks) / sizeof(tasks[0]));
 }
 
 // charley is a dope without hope
 void loop()
 {
-  const int offset_index = 8;
-  if (!decode_flag)
-    process_data();
-
-  if (DSP_Flag)
-  {
-    process_FT8_FFT();
-
-    if (xmit_flag)
-    {
-      if (!Tune_On)
-      {
-        if (ft8_xmit_counter >= offset_index && ft8_xmit_counter < 79 + offset_index)
-        {
-          set_FT8_Tone(tones[ft8_xmit_counter - offset_index]);
-        }
-
-        ft8_xmit_counter++;
-
-        if (ft8_xmit_counter == 80 + offset_index)
-        {
-          xmit_flag = 0;
-          terminate_transmit_armed();
-        }
-      }
-    }
-
-    display_time(880, 30);
-
-    DSP_Flag = 0;
-  }
-
-  if (decode_flag && !Tune_On && !xmit_flag) // start of servicing FT_Decode
-  {
-
-    master_decoded = ft8_decode();
-
-    display_messages(new_decoded, master_decoded);
-
-    for (int i = 0; i < master_decoded; ++i)
-    {
-      if (strindex(new_decoded[i].call_to, Station_Call) >= 0)
-      {
-        char received_message[22];
-        sprintf(received_message, "%s %s %s", new_decoded[i].call_to, new_decoded[i].call_from, new_decoded[i].locator);
-        strcpy(current_message, received_message);
-        update_message_log_display(0);
-      }
-    }
-
-    if (!was_txing)
-    {
-      for (int i = 0; i < master_decoded; i++)
-      {
-        // TX is (potentially) necessary
-        if (autoseq_on_decode(&new_decoded[i]))
-        {
-          // Fetch TX msg
-          if (autoseq_get_next_tx(autoseq_txbuf))
-          {
-            queue_custom_text(autoseq_txbuf);
-            QSO_xmit = 1;
-            tx_display_update();
-            break;
-          }
-        }
-      }
-
-      if (!QSO_xmit)
-      { // Check if QSO_xmit
-        // Check if retry is necessary
-        if (autoseq_get_next_tx(autoseq_txbuf))
-        {
-          queue_custom_text(autoseq_txbuf);
-          QSO_xmit = 1;
-        }
-        else if (Beacon_On)
-        {
-          target_slot = slot_state ^ 1; // toggle the slot
-          autoseq_start_cq();
-          autoseq_get_next_tx(autoseq_txbuf);
-          queue_custom_text(autoseq_txbuf);
-          QSO_xmit = 1;
-          tx_display_update();
-        }
-        else if (Auto_QSO)
-        {
-          // Auto_QSO_Start
-          if (Valid_CQ_Candidate)
-          {
-            process_selected_Station(master_decoded, max_sync_score_index);
-            autoseq_on_touch(&new_decoded[max_sync_score_index]);
-            autoseq_get_next_tx(autoseq_txbuf);
-            queue_custom_text(autoseq_txbuf);
-            QSO_xmit = 1;
-            tx_display_update();
-            store_CQ_Call();
-          }
-        } // Auto_QSO_End
-
-      } // Check if QSO_xmit End
-    }
-
-    decode_flag = 0;
-
-  } // end of sevicing FT_Decode
-
-  process_touch();
-
-  if (clr_pressed)
-  {
-    terminate_QSO();
-    QSO_xmit = 0;
-    was_txing = 0;
-    autoseq_init(Station_Call, Short_Station_Locator);
-    autoseq_txbuf[0] = '\0';
-    tx_display_update();
-    clr_pressed = false;
-  }
-
-  if (tx_pressed)
-  {
-    worked_qsos_in_display = display_worked_qsos();
-    tx_pressed = false;
-    tx_display_update();
-  }
-
-  if (!Tune_On && log_display_flag == 1)
-  {
-    display_logged_messages();
-    log_display_flag = 0;
-  }
-
-  if (!Tune_On && FT8_Touch_Flag && FT_8_TouchIndex < master_decoded)
-  {
-    process_selected_Station(master_decoded, FT_8_TouchIndex);
-    autoseq_on_touch(&new_decoded[FT_8_TouchIndex]);
-    autoseq_get_next_tx(autoseq_txbuf);
-    queue_custom_text(autoseq_txbuf);
-    QSO_xmit = 1;
-    FT8_Touch_Flag = 0;
-    tx_display_update();
-  }
-
-  update_synchronization();
+  tasks_run_next();
 }
 
 time_t getTeensy3Time()
@@ -395,6 +520,7 @@ time_t getTeensy3Time()
 
 static void process_data()
 {
+  PROFILE_SCOPE(PROFILE_PROCESS_DATA);
   if (audioQueue.available() >= num_que_blocks)
   {
     for (int i = 0; i < num_que_blocks; i++)
@@ -413,6 +539,7 @@ static void process_data()
     {
       dsp_buffer[length + i] = input_gulp[i * 5]; // decimation by 5
     }
+    recorder_push(dsp_buffer + length, FFT_BASE_SIZE);
 
     DSP_Flag = 1;
   }
@@ -428,8 +555,17 @@ void update_synchronization()
   int current_slot = ft8_time / 15000 % 2;
   if (current_slot != slot_state)
   {
+    // Decode a window still pending at the boundary before the slot turns over
+    if (ft8_flag)
+    {
+      queue_FT8_decode();
+      return;
+    }
+
     // toggle the slot state
     slot_state ^= 1;
+    trace_instant(TRACE_SLOT, slot_state);
+    recorder_slot_start(((now() + 7) / 15) * 15);
     if (was_txing)
     {
       autoseq_tick();
@@ -437,22 +573,34 @@ void update_synchronization()
 
     was_txing = 0;
 
+    pending_dt_correction = dt_end_of_slot();
+
     ft8_flag = 1;
-    FT_8_counter = 0;
+    mark_slot_start();
     ft8_marker = 1;
     WF_counter = 0;
     tx_display_update();
     getTime();
   }
 
+  // Nudge the slot timing well away from the boundaries so that
+  // moving start_time can never make the slot toggle back
+  int slot_time = ft8_time % 15000;
+  if (pending_dt_correction != 0 && slot_time > 2000 && slot_time < 12000)
+  {
+    start_time += pending_dt_correction;
+    dt_applied(pending_dt_correction);
+    pending_dt_correction = 0;
+  }
+
   // Check if TX is intended
   if (QSO_xmit && target_slot == slot_state && FT_8_counter < 29)
   {
     setup_to_transmit_on_next_DSP_Flag(); // TODO: move to main.c
     QSO_xmit = 0;
     was_txing = 1;
-    // Partial TX, set the TX counter based on current ft8_time
-    ft8_xmit_counter = (ft8_time % 15000) / 160; // 160ms per symbol
+    // A late start sends the whole message late, or skips the slot when too late
+    tx_scheduler_start(current_time - ft8_time % 15000);
 
     // Log the TX
     if (strindex(autoseq_txbuf, "CQ") < 0)
@@ -470,8 +618,47 @@ void sync_FT8(void)
   setSyncProvider(getTeensy3Time);
   Teensy3Clock.set(now()); // set the RTC
   start_time = millis();
+  pending_dt_correction = 0;
+  dt_reset(); // before the slot start takes the new timing
   ft8_flag = 1;
-  FT_8_counter = 0;
+  mark_slot_start();
   ft8_marker = 1;
   WF_counter = 0;
 }
+
+static void process_serial_command()
+{
+  if (!Serial.available())
+    return;
+
+  switch (Serial.read())
+  {
+  case 't': // DT correction history
+    dt_print_history();
+    break;
+  case 'j': // TX symbol clock jitter
+    tx_scheduler_print_stats();
+    break;
+  case 's': // task run times since the last dump
+    tasks_print_stats();
+    break;
+  case 'p': // hot path timings since the last dump
+    profile_print();
+    break;
+  case 'x': // slot timeline as Chrome trace_event JSON
+    trace_dump();
+    break;
+  case 'm': // memory budget and stack high water mark
+    memory_print();
+    break;
+  case 'a': // last 10 minutes of decodes as ALL.TXT
+    archive_dump(40);
+    break;
+  case 'A': // all of today's decodes as ALL.TXT
+    archive_dump(-1);
+    break;
+  case 'r': // start or stop recording the receive audio
+    recorder_toggle();
+    break;
+  }
+}
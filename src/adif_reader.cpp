@@ -0,0 +1,136 @@
+#include <string.h>
+#include <strings.h>
+#include <stddef.h>
+
+#include "adif_reader.h"
+
+enum Adif_State
+{
+  ADIF_TEXT,       // between tags
+  ADIF_TAG_NAME,   // after '<'
+  ADIF_TAG_LENGTH, // after the first ':'
+  ADIF_TAG_TYPE,   // after the second ':', e.g. <rst_sent:3:N>
+  ADIF_VALUE       // the characters counted by the length
+};
+
+struct Adif_Field
+{
+  const char *name;
+  size_t offset;
+  size_t size;
+};
+
+#define ADIF_FIELD(name) {#name, offsetof(Adif_Record, name), sizeof(((Adif_Record *)0)->name)}
+
+static const Adif_Field kAdif_fields[] = {
+    ADIF_FIELD(call),
+    ADIF_FIELD(gridsquare),
+    ADIF_FIELD(freq),
+    ADIF_FIELD(band),
+    ADIF_FIELD(qso_date),
+    ADIF_FIELD(time_on),
+    ADIF_FIELD(rst_sent),
+    ADIF_FIELD(rst_rcvd),
+};
+
+void adif_reader_init(Adif_Reader *reader, adif_handler_t handler, void *user)
+{
+  memset(reader, 0, sizeof(*reader));
+  reader->handler = handler;
+  reader->user = user;
+  reader->state = ADIF_TEXT;
+}
+
+// A tag without a length, <eor> ends a record and <eoh> the header
+static void end_of_tag(Adif_Reader *reader)
+{
+  if (strcasecmp(reader->tag, "eor") == 0)
+  {
+    if (reader->record.call[0] != 0)
+      reader->handler(&reader->record, reader->user);
+    memset(&reader->record, 0, sizeof(reader->record));
+  }
+  else if (strcasecmp(reader->tag, "eoh") == 0)
+  {
+    memset(&reader->record, 0, sizeof(reader->record));
+  }
+}
+
+// Called at the '>' of a tag with a length, sets up where the value goes
+static void start_value(Adif_Reader *reader)
+{
+  reader->value = NULL;
+  reader->value_pos = 0;
+
+  for (const Adif_Field &field : kAdif_fields)
+  {
+    if (strcasecmp(reader->tag, field.name) == 0)
+    {
+      reader->value = (char *)&reader->record + field.offset;
+      reader->value_size = field.size;
+      memset(reader->value, 0, field.size);
+      break;
+    }
+  }
+
+  reader->state = (reader->value_len > 0) ? ADIF_VALUE : ADIF_TEXT;
+}
+
+void adif_reader_feed(Adif_Reader *reader, const char *data, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    char c = data[i];
+
+    switch (reader->state)
+    {
+    case ADIF_TEXT:
+      if (c == '<')
+      {
+        reader->tag_len = 0;
+        reader->tag[0] = 0;
+        reader->state = ADIF_TAG_NAME;
+      }
+      break;
+
+    case ADIF_TAG_NAME:
+      if (c == ':')
+      {
+        reader->value_len = 0;
+        reader->state = ADIF_TAG_LENGTH;
+      }
+      else if (c == '>')
+      {
+        end_of_tag(reader);
+        reader->state = ADIF_TEXT;
+      }
+      else if (reader->tag_len < sizeof(reader->tag) - 1)
+      {
+        reader->tag[reader->tag_len++] = c;
+        reader->tag[reader->tag_len] = 0;
+      }
+      break;
+
+    case ADIF_TAG_LENGTH:
+      if (c >= '0' && c <= '9')
+        reader->value_len = reader->value_len * 10 + (c - '0');
+      else if (c == ':')
+        reader->state = ADIF_TAG_TYPE;
+      else if (c == '>')
+        start_value(reader);
+      break;
+
+    case ADIF_TAG_TYPE:
+      if (c == '>')
+        start_value(reader);
+      break;
+
+    case ADIF_VALUE:
+      if (reader->value != NULL && reader->value_pos < reader->value_size - 1)
+        reader->value[reader->value_pos] = c;
+      if (++reader->value_pos >= reader->value_len)
+        reader->state = ADIF_TEXT;
+      break;
+    }
+  }
+}
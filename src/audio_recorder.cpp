@@ -0,0 +1,259 @@
+#include <string.h>
+#include <stdio.h>
+
+#include <SD.h>
+#include <TimeLib.h>
+
+#include "audio_recorder.h"
+#include "memory_map.h"
+
+#define RECORD_BUFFER_SAMPLES 8192 // 1.28 s, 32 sectors
+#define WAV_HEADER_SIZE 512        // padded with a JUNK chunk so the samples start on a sector
+
+struct Record_Buffer
+{
+  int16_t samples[RECORD_BUFFER_SAMPLES];
+  uint32_t length;
+  uint32_t start;     // position of samples[0] in the slot, counting lost samples
+  uint32_t slot_time; // a buffer never holds samples from two slots
+  bool full;
+};
+
+// Both buffers are only touched from loop() tasks, so plain flags are enough.
+// BULK_RAM is not cleared at startup, see recorder_begin()
+static BULK_RAM Record_Buffer record_buffers[2] __attribute__((aligned(32)));
+static int fill_index = 0;
+static bool record_armed = false;
+static bool recording = false;
+static uint32_t record_slot;
+static uint32_t slot_position; // samples of the slot pushed so far
+static uint32_t lost_samples = 0;
+
+// Length of the last slot that ended, so that its file can be padded when
+// the samples at its end were lost
+static uint32_t ended_slot;
+static uint32_t ended_slot_length;
+
+static File record_file;
+static uint32_t record_file_slot;
+
+static void put_u32(uint8_t *p, uint32_t value)
+{
+  p[0] = value;
+  p[1] = value >> 8;
+  p[2] = value >> 16;
+  p[3] = value >> 24;
+}
+
+static void put_u16(uint8_t *p, uint16_t value)
+{
+  p[0] = value;
+  p[1] = value >> 8;
+}
+
+// RIFF header of a mono 16-bit WAV, the sizes are filled in when the file is closed
+static void make_wav_header(uint8_t *header, uint32_t data_size)
+{
+  memset(header, 0, WAV_HEADER_SIZE);
+
+  memcpy(header, "RIFF", 4);
+  put_u32(header + 4, WAV_HEADER_SIZE - 8 + data_size);
+  memcpy(header + 8, "WAVE", 4);
+
+  memcpy(header + 12, "fmt ", 4);
+  put_u32(header + 16, 16);
+  put_u16(header + 20, 1); // PCM
+  put_u16(header + 22, 1); // mono
+  put_u32(header + 24, RECORD_SAMPLE_RATE);
+  put_u32(header + 28, RECORD_SAMPLE_RATE * 2);
+  put_u16(header + 32, 2);
+  put_u16(header + 34, 16);
+
+  memcpy(header + 36, "JUNK", 4);
+  put_u32(header + 40, WAV_HEADER_SIZE - 8 - 44);
+
+  memcpy(header + WAV_HEADER_SIZE - 8, "data", 4);
+  put_u32(header + WAV_HEADER_SIZE - 4, data_size);
+}
+
+static void open_file(uint32_t slot_time)
+{
+  char name[40];
+  time_t t = slot_time;
+  snprintf(name, sizeof(name), RECORD_DIR "/%04d%02d%02d_%02d%02d%02d.WAV",
+           year(t), month(t), day(t), hour(t), minute(t), second(t));
+
+  if (!SD.exists(RECORD_DIR))
+    SD.mkdir(RECORD_DIR);
+
+  record_file = SD.open(name, FILE_WRITE);
+  record_file_slot = slot_time;
+  if (!record_file)
+    return;
+
+  uint8_t header[WAV_HEADER_SIZE];
+  make_wav_header(header, 0);
+  record_file.write(header, sizeof(header));
+}
+
+// Samples written to the file so far
+static uint32_t file_samples(void)
+{
+  return (record_file.size() - WAV_HEADER_SIZE) / sizeof(int16_t);
+}
+
+// Silence in place of lost samples, so that the file keeps the time axis
+static void pad_file(uint32_t position)
+{
+  static const int16_t silence[256] = {0};
+
+  uint32_t written = file_samples();
+  while (written < position)
+  {
+    uint32_t count = position - written;
+    if (count > sizeof(silence) / sizeof(silence[0]))
+      count = sizeof(silence) / sizeof(silence[0]);
+    if (record_file.write((const uint8_t *)silence, count * sizeof(int16_t)) != count * sizeof(int16_t))
+      return;
+    written += count;
+  }
+}
+
+static void close_file(void)
+{
+  if (!record_file)
+    return;
+
+  if (record_file_slot == ended_slot)
+    pad_file(ended_slot_length);
+
+  uint8_t header[WAV_HEADER_SIZE];
+  make_wav_header(header, record_file.size() - WAV_HEADER_SIZE);
+  record_file.seek(0);
+  record_file.write(header, sizeof(header));
+  record_file.close();
+  record_file = File();
+}
+
+// Hand the fill buffer to the writer, or drop its samples if the writer is
+// behind. The writer pads the file with silence up to the start of the next
+// buffer, so a dropped buffer leaves a gap rather than shifting the audio.
+static void seal(void)
+{
+  Record_Buffer *fill = &record_buffers[fill_index];
+  Record_Buffer *other = &record_buffers[fill_index ^ 1];
+
+  if (fill->length == 0)
+    return;
+
+  if (other->full)
+  {
+    lost_samples += fill->length;
+    fill->length = 0;
+    fill->start = slot_position;
+    return;
+  }
+
+  fill->full = true;
+  fill_index ^= 1;
+  other->length = 0;
+  other->start = slot_position;
+  other->slot_time = record_slot;
+}
+
+void recorder_begin(void)
+{
+  memset(record_buffers, 0, sizeof(record_buffers));
+}
+
+void recorder_toggle(void)
+{
+  record_armed = !record_armed;
+  if (record_armed)
+  {
+    lost_samples = 0;
+    Serial.println("Recording from the next slot");
+  }
+  else
+  {
+    Serial.printf("Recording stops at the end of the slot, %lu samples (%lu ms) lost\n",
+                  (unsigned long)lost_samples, (unsigned long)(lost_samples * 1000ULL / RECORD_SAMPLE_RATE));
+  }
+}
+
+void recorder_slot_start(time_t slot_time)
+{
+  if (recording)
+  {
+    seal();
+    ended_slot = record_slot;
+    ended_slot_length = slot_position;
+  }
+
+  recording = record_armed;
+  record_slot = (uint32_t)slot_time;
+  slot_position = 0;
+
+  Record_Buffer *fill = &record_buffers[fill_index];
+  fill->length = 0;
+  fill->start = 0;
+  fill->slot_time = record_slot;
+}
+
+void recorder_push(const int16_t *samples, int num_samples)
+{
+  if (!recording)
+    return;
+
+  while (num_samples > 0)
+  {
+    Record_Buffer *fill = &record_buffers[fill_index];
+    int count = RECORD_BUFFER_SAMPLES - fill->length;
+    if (count > num_samples)
+      count = num_samples;
+
+    memcpy(fill->samples + fill->length, samples, count * sizeof(int16_t));
+    fill->length += count;
+    slot_position += count;
+    samples += count;
+    num_samples -= count;
+
+    if (fill->length == RECORD_BUFFER_SAMPLES)
+      seal();
+  }
+}
+
+bool recorder_pending(void)
+{
+  return record_buffers[0].full || record_buffers[1].full || (record_file && !recording);
+}
+
+void recorder_write(void)
+{
+  Record_Buffer *buffer = NULL;
+  if (record_buffers[0].full)
+    buffer = &record_buffers[0];
+  else if (record_buffers[1].full)
+    buffer = &record_buffers[1];
+
+  // Nothing left of a finished recording
+  if (buffer == NULL)
+  {
+    close_file();
+    return;
+  }
+
+  if (!record_file || record_file_slot != buffer->slot_time)
+  {
+    close_file();
+    open_file(buffer->slot_time);
+  }
+
+  if (record_file)
+  {
+    pad_file(buffer->start);
+    record_file.write((const uint8_t *)buffer->samples, buffer->length * sizeof(int16_t));
+  }
+
+  buffer->full = false;
+}
@@ -66,10 +66,11 @@ static autoseq_ctx_t ctx;
 /*************** Forward declarations ****************/
 static void set_state(autoseq_state_t s, tx_msg_t first_tx, int limit);
 static void format_tx_text(tx_msg_t id, char *out);
+static void on_tx_queued(tx_msg_t id);
+static void precompute_tx_messages(void);
 static void parse_rcvd_msg(const Decode *msg);
 // Internal helper called by autoseq_on_touch() and autoseq_on_decode()
 static bool generate_response(const Decode *msg, bool override);
-static void write_worked_qso();
 
 /******************************************************/
 
@@ -147,6 +148,8 @@ bool autoseq_get_next_tx(char *out_text)
     if (ctx.next_tx == TX_UNDEF)
         return false;
 
+    on_tx_queued(ctx.next_tx);
+
     /* Bump retry counter */
     if (ctx.retry_limit && ctx.retry_counter >= ctx.retry_limit)
     {
@@ -249,6 +252,25 @@ static void set_state(autoseq_state_t s, tx_msg_t first_tx, int limit)
     ctx.next_tx = first_tx;
     ctx.retry_counter = 0;
     ctx.retry_limit = limit;
+
+    if (s != AS_IDLE)
+        precompute_tx_messages();
+}
+
+/* Encode the whole TX1…TX6 set for the current DX up front, so queueing
+ * any of them later only swaps the tone sequence */
+static void precompute_tx_messages(void)
+{
+    char text[MAX_MSG_LEN];
+
+    // Calling CQ has no DX yet, only TX6 can be sent
+    int first = strcmp(ctx.dxcall, CQ) == 0 ? TX6 : TX1;
+    for (int id = first; id <= TX6; ++id)
+    {
+        format_tx_text((tx_msg_t)id, text);
+        if (text[0])
+            cache_custom_text(text);
+    }
 }
 
 static void log_and_write_qso()
@@ -256,7 +278,7 @@ static void log_and_write_qso()
     if (!ctx.logged)
     {
         write_ADIF_Log();
-        write_worked_qso();
+        add_worked_qso(BandIndex, ctx.dxcall, Station_RSL, Target_RSL);
         ctx.logged = true;
     }
 }
@@ -280,19 +302,15 @@ static void format_tx_text(tx_msg_t id, char *out)
         break;
     case TX2:
         snprintf(out, MAX_MSG_LEN, "%s %s %+d", ctx.dxcall, ctx.mycall, ctx.snr_tx);
-        Target_RSL = ctx.snr_tx;
         break;
     case TX3:
         snprintf(out, MAX_MSG_LEN, "%s %s R%+d", ctx.dxcall, ctx.mycall, ctx.snr_tx);
-        Target_RSL = ctx.snr_tx;
         break;
     case TX4:
         snprintf(out, MAX_MSG_LEN, "%s %s RR73", ctx.dxcall, ctx.mycall);
-        log_and_write_qso();
         break;
     case TX5:
         snprintf(out, MAX_MSG_LEN, "%s %s 73", ctx.dxcall, ctx.mycall);
-        log_and_write_qso();
         break;
     case TX6:
         if (!free_text)
@@ -335,6 +353,25 @@ static void format_tx_text(tx_msg_t id, char *out)
     }
 }
 
+/* Bookkeeping for the message actually being sent, kept out of
+ * format_tx_text() so that precomputing the set has no side effects */
+static void on_tx_queued(tx_msg_t id)
+{
+    switch (id)
+    {
+    case TX2:
+    case TX3:
+        Target_RSL = ctx.snr_tx;
+        break;
+    case TX4:
+    case TX5:
+        log_and_write_qso();
+        break;
+    default:
+        break;
+    }
+}
+
 static void parse_rcvd_msg(const Decode *msg)
 {
     ctx.rcvd_msg_type = TX_UNDEF;
@@ -524,47 +561,3 @@ static bool generate_response(const Decode *msg, bool override)
     }
     return false;
 }
-
-static void write_worked_qso()
-{
-    static const char band_strs[NumBands][4] = {
-        "40", "30", "20", "17", "15", "12", "10"};
-    char *buf = add_worked_qso();
-    if (!buf)
-        return;
-
-    int printed = snprintf(buf, MAX_LINE_LEN, "%.3s %.12s",
-                           band_strs[BandIndex],
-                           ctx.dxcall);
-    if (printed < 0 || printed >= MAX_LINE_LEN)
-    {
-        return;
-    }
-
-    char rsl[RSL_SIZE]; // space + sign + 2 digits + null = 5
-    // Check if RX RSL would fit
-    int needed = snprintf(rsl, sizeof(rsl), " %d", Station_RSL);
-    if (needed > 0 && printed + needed < MAX_LINE_LEN)
-    {
-        strncpy(buf + printed, rsl, MAX_LINE_LEN - printed - 1);
-        printed += needed;
-        buf[printed] = '\0';
-    }
-    else
-    {
-        buf[printed] = '\0';
-        return;
-    }
-
-    // Check if TX RSL would fit
-    needed = snprintf(rsl, sizeof(rsl), " %d", Target_RSL);
-    if (needed > 0 && printed + needed < MAX_LINE_LEN)
-    {
-        strncpy(buf + printed, rsl, MAX_LINE_LEN - printed - 1);
-        buf[printed + needed] = '\0';
-    }
-    else
-    {
-        buf[printed] = '\0';
-    }
-}
@@ -19,6 +19,8 @@
 #include "Maps.h"
 #include "PskInterface.h"
 #include "autoseq_engine.h"
+#include "tx_scheduler.h"
+#include "touch_queue.h"
 
 #define Board_PIN 2
 #define Relay_PIN 3
@@ -450,11 +452,105 @@ void display_all_buttons(void)
   drawButton(10);
 }
 
+// Grid over the screen listing the buttons and touch regions that reach
+// into each cell, so a touch is only tested against its neighbours
+#define TOUCH_CELL_W 64
+#define TOUCH_CELL_H 40
+#define TOUCH_GRID_W (SCREEN_WIDTH / TOUCH_CELL_W)
+#define TOUCH_GRID_H (SCREEN_HEIGHT / TOUCH_CELL_H)
+
+enum TouchRegion
+{
+  REGION_DECODES = 0,
+  REGION_XMIT_MESSAGE,
+  REGION_WATERFALL,
+  REGION_WORKED_QSOS,
+  NUM_REGIONS
+};
+
+struct TouchCell
+{
+  uint32_t buttons; // bit i set for sButtonData[i]
+  uint8_t regions;  // bit set for each TouchRegion
+};
+
+static_assert(numButtons <= 32, "touch cells hold one bit per button");
+
+// Bounds of the touch regions, exclusive on every side: a touch is in a
+// region when left < x < right and top < y < bottom
+static const struct
+{
+  int16_t left, top, right, bottom;
+} kTouch_regions[NUM_REGIONS] = {
+    {-1, 100, 320, 500},                  // REGION_DECODES
+    {400, 380, 640, 550},                 // REGION_XMIT_MESSAGE
+    {-1, -1, 600, 90},                    // REGION_WATERFALL
+    {START_X_RIGHT, 120, INT16_MAX, 400}, // REGION_WORKED_QSOS
+};
+
+static TouchCell touch_grid[TOUCH_GRID_H][TOUCH_GRID_W];
+
+static void mark_touch_cells(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint32_t buttons, uint8_t regions)
+{
+  int col_end = min((x + w) / TOUCH_CELL_W, TOUCH_GRID_W - 1);
+  int row_end = min((y + h) / TOUCH_CELL_H, TOUCH_GRID_H - 1);
+
+  for (int row = y / TOUCH_CELL_H; row <= row_end; ++row)
+  {
+    for (int col = x / TOUCH_CELL_W; col <= col_end; ++col)
+    {
+      touch_grid[row][col].buttons |= buttons;
+      touch_grid[row][col].regions |= regions;
+    }
+  }
+}
+
+void build_touch_index(void)
+{
+  memset(touch_grid, 0, sizeof(touch_grid));
+
+  for (int i = 0; i < numButtons; i++)
+  {
+    const ButtonStruct *button = &sButtonData[i];
+    if (button->w && button->h)
+      mark_touch_cells(button->x, button->y, button->w, button->h, 1UL << i, 0);
+  }
+
+  for (int i = 0; i < NUM_REGIONS; i++)
+  {
+    uint16_t x = max((int)kTouch_regions[i].left, 0);
+    uint16_t y = max((int)kTouch_regions[i].top, 0);
+    uint16_t right = min((int)kTouch_regions[i].right, SCREEN_WIDTH);
+    uint16_t bottom = min((int)kTouch_regions[i].bottom, SCREEN_HEIGHT);
+    mark_touch_cells(x, y, right - x, bottom - y, 0, 1 << i);
+  }
+}
+
+static const TouchCell *touch_cell(void)
+{
+  int col = min(draw_x / TOUCH_CELL_W, TOUCH_GRID_W - 1);
+  int row = min(draw_y / TOUCH_CELL_H, TOUCH_GRID_H - 1);
+  return &touch_grid[row][col];
+}
+
+static bool in_touch_region(TouchRegion region)
+{
+  if (!(touch_cell()->regions & (1 << region)))
+    return false;
+
+  return draw_x > kTouch_regions[region].left && draw_x < kTouch_regions[region].right &&
+         draw_y > kTouch_regions[region].top && draw_y < kTouch_regions[region].bottom;
+}
+
 void checkButton(void)
 {
-  uint16_t i;
-  for (i = 0; i < numButtons; i++)
+  // Buttons may overlap, so every candidate is tested in index order
+  uint32_t candidates = touch_cell()->buttons;
+  while (candidates)
   {
+    int i = __builtin_ctz(candidates);
+    candidates &= candidates - 1;
+
     if (testButton(i))
     {
       switch (sButtonData[i].Active)
@@ -877,9 +973,9 @@ int FT8_Touch(void)
 {
   int y_test;
 
-  if (draw_x < 320 && (draw_y > 100 && draw_y < 500))
+  if (in_touch_region(REGION_DECODES))
   {
-    y_test = draw_y - 100;
+    y_test = draw_y - kTouch_regions[REGION_DECODES].top;
 
     FT_8_TouchIndex = y_test / 40;
     return 1;
@@ -890,12 +986,12 @@ int FT8_Touch(void)
 
 int Xmit_message_Touch(void)
 {
-  return ((draw_x > 400 && draw_x < 640) && (draw_y > 380 && draw_y < 550));
+  return in_touch_region(REGION_XMIT_MESSAGE);
 }
 
 void check_WF_Touch(void)
 {
-  if (draw_x < 600 && draw_y < 90)
+  if (in_touch_region(REGION_WATERFALL))
   {
     display_cursor_line = draw_x;
     cursor_line = display_cursor_line / 2;
@@ -912,44 +1008,31 @@ void set_startup_freq(void)
   display_value(870, 559, cursor_freq);
 }
 
-#define MAXTOUCHLIMIT 10
-
+// Act on each touch once, when it lands. Dragging only moves the waterfall cursor
 void process_touch(void)
 {
-  static int touch_count = 0;
+  touch_poll();
 
-  if (touch_count < MAXTOUCHLIMIT)
+  Touch_Event event;
+  while (touch_get_event(&event))
   {
-    if (tft.touched())
-    { // if touched(true) detach isr
-      // at this point we need to fill the FT5206 registers...
-      tft.updateTS(); // now we have the data inside library
-
-      uint16_t coordinates[MAXTOUCHLIMIT][2]; // to hold coordinates
-      tft.getTScoordinates(coordinates);      // done
-      // now coordinates has the x,y of all touches
-      for (uint8_t i = 0; i < tft.getTouches(); i++)
-      {
-        if (i == 0)
-        {
-          draw_x = SCREEN_WIDTH - coordinates[i][0];
-          draw_y = SCREEN_HEIGHT - coordinates[i][1];
-        }
-      }
-      tft.enableCapISR(); // rearm ISR if needed (touched(true))
+    if (event.type == TOUCH_RELEASE)
+      continue;
+
+    draw_x = event.x;
+    draw_y = event.y;
 
-      touch_count++;
+    if (event.type == TOUCH_DRAG)
+    {
+      check_WF_Touch();
+      continue;
     }
-  }
 
-  if (touch_count >= MAXTOUCHLIMIT)
-  {
     checkButton();
     FT8_Touch_Flag = FT8_Touch();
     FT8_Message_Touch = Xmit_message_Touch();
     check_WF_Touch();
-    touch_count = 0;
-    if (!Tune_On && (draw_x > START_X_RIGHT && draw_y > 120 && draw_y < 400))
+    if (!Tune_On && in_touch_region(REGION_WORKED_QSOS))
       tx_pressed = true;
   }
 }
@@ -14,6 +14,7 @@
 #include "decode.h"
 #include "constants.h"
 #include "Process_DSP.h"
+#include "profile.h"
 
 static float max2(float a, float b);
 static float max4(float a, float b, float c, float d);
@@ -21,13 +22,24 @@ static void heapify_down(Candidate *heap, int heap_size);
 static void heapify_up(Candidate *heap, int heap_size);
 static void decode_symbol(const uint8_t *power, const uint8_t *code_map,
                           int bit_idx, float *log174);
+static void decode_multi_symbols(const uint8_t *const power[], int n_syms,
+                                 const uint8_t *code_map, int bit_idx, float *log174);
+
+// Pointer to the first row of a block of the window, wrapping around the ring
+static const uint8_t *spectrogram_block(const Spectrogram *spectrogram, int block)
+{
+  int ring_block = (spectrogram->first_block + block) % spectrogram->ring_blocks;
+  return spectrogram->power + ring_block * 4 * spectrogram->num_bins;
+}
 
 // Localize top N candidates in frequency and time according to their sync strength (looking at Costas symbols)
 // We treat and organize the candidate list as a min-heap (empty initially).
-int find_sync(const uint8_t *power, int num_blocks, int num_bins,
-              const uint8_t *sync_map, int num_candidates, Candidate *heap,
-              int min_score)
+int find_sync(const Spectrogram *spectrogram, const uint8_t *sync_map,
+              int num_candidates, Candidate *heap, int min_score)
 {
+  PROFILE_SCOPE(PROFILE_FIND_SYNC);
+  const int num_blocks = spectrogram->num_blocks;
+  const int num_bins = spectrogram->num_bins;
   int heap_size = 0;
   // int x = 500;
   // Here we allow time offsets that exceed signal boundaries, as long as we still have all data bits.
@@ -56,9 +68,7 @@ int find_sync(const uint8_t *power, int num_blocks, int num_bins,
             if (time_offset + k + m >= num_blocks)
               break;
 
-            int offset = ((time_offset + k + m) * 4 + alt) * num_bins + freq_offset;
-
-            const uint8_t *p8 = power + offset;
+            const uint8_t *p8 = spectrogram_block(spectrogram, time_offset + k + m) + alt * num_bins + freq_offset;
 
             score += 8 * p8[sync_map[k]] - p8[0] - p8[1] - p8[2] - p8[3] - p8[4] - p8[5] - p8[6] - p8[7];
 
@@ -102,24 +112,35 @@ int find_sync(const uint8_t *power, int num_blocks, int num_bins,
 
 // Compute log likelihood log(p(1) / p(0)) of 174 message bits
 // for later use in soft-decision LDPC decoding
-void extract_likelihood(const uint8_t *power, int num_bins, Candidate cand,
-                        const uint8_t *code_map, float *log174)
+void extract_likelihood(const Spectrogram *spectrogram, Candidate cand,
+                        const uint8_t *code_map, int n_syms, float *log174)
 {
+  int offset = (cand.time_sub * 2 + cand.freq_sub) * spectrogram->num_bins + cand.freq_offset;
 
-  int offset = (cand.time_offset * 4 + cand.time_sub * 2 + cand.freq_sub) * num_bins + cand.freq_offset;
-
-  // show_variable(600,200,offset);
-  //  Go over FSK tones and skip Costas sync symbols
-  const int n_syms = 1;
-  for (int k = 0; k < ND; k += n_syms)
+  //  Go over FSK tones and skip Costas sync symbols.
+  //  Groups of n_syms never straddle the middle Costas block, so the last
+  //  group of each half may hold fewer symbols.
+  int k = 0;
+  while (k < ND)
   {
-    int sym_idx = (k < ND / 2) ? (k + 7) : (k + 14);
+    int half_end = (k < ND / 2) ? ND / 2 : ND;
+    int group = (half_end - k < n_syms) ? half_end - k : n_syms;
     int bit_idx = 3 * k;
 
-    // Pointer to 8 bins of the current symbol
-    const uint8_t *ps = power + (offset + sym_idx * 4 * num_bins);
+    // Pointers to 8 bins of each symbol of the group
+    const uint8_t *ps[kMax_likelihood_syms];
+    for (int s = 0; s < group; ++s)
+    {
+      int sym_idx = (k + s < ND / 2) ? (k + s + 7) : (k + s + 14);
+      ps[s] = spectrogram_block(spectrogram, cand.time_offset + sym_idx) + offset;
+    }
+
+    if (group == 1)
+      decode_symbol(ps[0], code_map, bit_idx, log174);
+    else
+      decode_multi_symbols(ps, group, code_map, bit_idx, log174);
 
-    decode_symbol(ps, code_map, bit_idx, log174);
+    k += group;
   }
 
   // Compute the variance of log174
@@ -218,3 +239,42 @@ static void decode_symbol(const uint8_t *power, const uint8_t *code_map,
   log174[bit_idx + 1] = max4(s2[2], s2[3], s2[6], s2[7]) - max4(s2[0], s2[1], s2[4], s2[5]);
   log174[bit_idx + 2] = max4(s2[1], s2[3], s2[5], s2[7]) - max4(s2[0], s2[2], s2[4], s2[6]);
 }
+
+// Compute unnormalized log likelihood log(p(1) / p(0)) of 3 * n_syms message bits
+// jointly over n_syms consecutive FSK symbols (non-coherent block detection)
+static void decode_multi_symbols(const uint8_t *const power[], int n_syms,
+                                 const uint8_t *code_map, int bit_idx, float *log174)
+{
+  const int n_bits = 3 * n_syms;
+  const int n_tones = (1 << n_bits);
+
+  float s2[1 << (3 * kMax_likelihood_syms)];
+
+  for (int j = 0; j < n_tones; ++j)
+  {
+    // The first symbol of the group carries the most significant bits
+    float sum = 0;
+    for (int s = 0; s < n_syms; ++s)
+    {
+      int tone = (j >> (3 * (n_syms - 1 - s))) & 0x07;
+      sum += power[s][code_map[tone]];
+    }
+    s2[j] = sum;
+  }
+
+  // Extract bit significance (and convert them to float)
+  for (int i = 0; i < n_bits; ++i)
+  {
+    int mask = (n_tones >> (i + 1));
+    float max_zero = -1000, max_one = -1000;
+    for (int n = 0; n < n_tones; ++n)
+    {
+      if (n & mask)
+        max_one = max2(max_one, s2[n]);
+      else
+        max_zero = max2(max_zero, s2[n]);
+    }
+
+    log174[bit_idx + i] = max_one - max_zero;
+  }
+}
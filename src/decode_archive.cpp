@@ -0,0 +1,173 @@
+#include <string.h>
+#include <stdio.h>
+
+#include <SD.h>
+#include <TimeLib.h>
+
+#include "decode_archive.h"
+#include "unpack.h"
+#include "sd_retry.h"
+
+#define ARCHIVE_BATCH 32 // decodes of one slot, more than the decoder keeps
+
+static Archive_Record archive_batch[ARCHIVE_BATCH];
+static int archive_count = 0;
+static uint32_t slots_dropped = 0;
+static Sd_Retry archive_retry = {"the decode archive"};
+
+static void file_name(char *name, size_t size, time_t slot_time, const char *extension)
+{
+  snprintf(name, size, ARCHIVE_DIR "/%04d%02d%02d.%s", year(slot_time), month(slot_time), day(slot_time), extension);
+}
+
+void archive_begin(void)
+{
+  if (!SD.exists(ARCHIVE_DIR))
+    SD.mkdir(ARCHIVE_DIR);
+}
+
+void archive_add(time_t slot_time, int dial_khz, int freq_hz, int dt_ms, int snr, const uint8_t *a77)
+{
+  // A slot that was never flushed goes out now rather than mixing with this
+  // one, or is dropped when the card is not taking writes
+  if (archive_count > 0 && archive_batch[0].slot_time != (uint32_t)slot_time)
+  {
+    if (sd_retry_due(&archive_retry))
+      archive_flush();
+    if (archive_count > 0)
+    {
+      slots_dropped++;
+      archive_count = 0;
+    }
+  }
+
+  if (archive_count >= ARCHIVE_BATCH)
+    return;
+
+  Archive_Record *record = &archive_batch[archive_count++];
+  memset(record, 0, sizeof(*record));
+  record->slot_time = (uint32_t)slot_time;
+  record->dial_khz = dial_khz;
+  record->freq_hz = freq_hz;
+  record->dt_ms = dt_ms;
+  record->snr = snr;
+  memcpy(record->payload, a77, sizeof(record->payload));
+}
+
+bool archive_pending(void)
+{
+  return archive_count > 0 && sd_retry_due(&archive_retry);
+}
+
+// Append the batch and its index entry, a failure leaves both files as they were
+static bool write_batch(void)
+{
+  char name[32];
+  Archive_Index entry;
+  entry.slot_time = archive_batch[0].slot_time;
+  entry.num_records = archive_count;
+
+  file_name(name, sizeof(name), entry.slot_time, "DEC");
+  File records = SD.open(name, FILE_WRITE);
+  file_name(name, sizeof(name), entry.slot_time, "IDX");
+  File index = SD.open(name, FILE_WRITE);
+  if (!records || !index)
+  {
+    records.close();
+    index.close();
+    return false;
+  }
+
+  // Whole records and entries only, a part left by an earlier failure is cut off
+  uint32_t records_size = records.size() / sizeof(Archive_Record) * sizeof(Archive_Record);
+  uint32_t index_size = index.size() / sizeof(Archive_Index) * sizeof(Archive_Index);
+  records.truncate(records_size);
+  index.truncate(index_size);
+
+  entry.first_record = records_size / sizeof(Archive_Record);
+  size_t length = entry.num_records * sizeof(Archive_Record);
+  records.seek(records_size);
+  bool ok = records.write((const uint8_t *)archive_batch, length) == length;
+  if (ok)
+  {
+    index.seek(index_size);
+    ok = index.write((const uint8_t *)&entry, sizeof(entry)) == sizeof(entry);
+  }
+
+  // Records without an index entry could not be found by slot
+  if (!ok)
+  {
+    records.truncate(records_size);
+    index.truncate(index_size);
+  }
+  records.close();
+  index.close();
+  return ok;
+}
+
+void archive_flush(void)
+{
+  if (archive_count == 0)
+    return;
+
+  if (!write_batch())
+  {
+    sd_retry_failed(&archive_retry);
+    return;
+  }
+  sd_retry_ok(&archive_retry);
+  archive_count = 0;
+
+  if (slots_dropped > 0)
+  {
+    Serial.printf("Decode archive was not written, %lu slots dropped\n", (unsigned long)slots_dropped);
+    slots_dropped = 0;
+  }
+}
+
+// 240101_120015    14.074 Rx FT8    -12  0.3 1234 CQ K1ABC FN42
+static void print_record(const Archive_Record *record)
+{
+  char message[35];
+  if (unpack77(record->payload, message) < 0)
+    strcpy(message, "<unpack failed>");
+
+  time_t t = record->slot_time;
+  Serial.printf("%02d%02d%02d_%02d%02d%02d %6lu.%03lu Rx FT8 %6d %4.1f %4u %s\n",
+                year(t) % 100, month(t), day(t), hour(t), minute(t), second(t),
+                (unsigned long)(record->dial_khz / 1000), (unsigned long)(record->dial_khz % 1000),
+                record->snr, record->dt_ms / 1000.0f, record->freq_hz, message);
+}
+
+void archive_dump(int num_slots)
+{
+  char name[32];
+  time_t today = now();
+
+  file_name(name, sizeof(name), today, "IDX");
+  File index = SD.open(name, FILE_READ);
+  file_name(name, sizeof(name), today, "DEC");
+  File records = SD.open(name, FILE_READ);
+  if (!index || !records)
+  {
+    index.close();
+    records.close();
+    Serial.println("No decodes archived today");
+    return;
+  }
+
+  // The index finds the first record of the oldest slot asked for
+  uint32_t num_entries = index.size() / sizeof(Archive_Index);
+  uint32_t first_entry = (num_slots >= 0 && (uint32_t)num_slots < num_entries) ? num_entries - num_slots : 0;
+  Archive_Index entry;
+  index.seek(first_entry * sizeof(Archive_Index));
+  if (first_entry < num_entries && index.read(&entry, sizeof(entry)) == (int)sizeof(entry))
+    records.seek(entry.first_record * sizeof(Archive_Record));
+
+  Archive_Record record;
+  while (records.read(&record, sizeof(record)) == (int)sizeof(record))
+    print_record(&record);
+
+  index.close();
+  records.close();
+}
@@ -33,6 +33,12 @@
 #include "Geodesy.h"
 #include "PskInterface.h"
 #include "autoseq_engine.h"
+#include "dt_estimator.h"
+#include "profile.h"
+#include "trace.h"
+#include "memory_map.h"
+#include "worked_before.h"
+#include "decode_archive.h"
 
 int blank_length = 26;
 
@@ -42,156 +48,280 @@ const int kMax_decoded_messages = 20;
 size_t kMax_message_length = 20;
 const int kMin_score = 40; // Minimum sync score threshold for candidates
 
+// Likelihood passes: the first pass tries every candidate with single symbol
+// metrics, the deeper passes retry the strongest leftovers with joint metrics
+struct Decode_Pass
+{
+  int n_syms;
+  int max_candidates;
+};
+
+static const Decode_Pass kDecode_passes[] = {
+    {1, kMax_candidates},
+    {2, 6},
+    {3, 3}};
+
 Decode new_decoded[20];
 
 static const char *blank = "                      "; // 22 spaces
 static const char *auto_blank = "             ";     // 14 spaces
-static char worked_qso_entries[MAX_QSO_ENTRIES][MAX_LINE_LEN] = {};
+static BULK_RAM char worked_qso_entries[MAX_QSO_ENTRIES][MAX_LINE_LEN]; // only read below num_qsos
 static int num_qsos = 0;
 
 static int validate_locator(const char *QSO_locator);
+static void sort_candidates(Candidate *candidates, int num_candidates);
 
 const int auto_call_limit = 10;
-const int auto_logged_limit = 100;
 
 int max_sync_score;
 int max_sync_score_index;
 Called_Stations call_list[auto_call_limit];
-Called_Stations auto_logged_list[auto_logged_limit];
 
 int auto_logged;
 int Valid_CQ_Candidate;
 
-int ft8_decode(void)
+// State of the decode in progress, kept between the steps of ft8_decode_step()
+enum Decode_Stage
 {
-  // Find top candidates by Costas sync score and localize them in time and frequency
-  Candidate candidate_list[kMax_candidates];
-
-  int num_candidates = find_sync(export_fft_power, ft8_msg_samples, ft8_buffer, kCostas_map, kMax_candidates, candidate_list, kMin_score);
-  char decoded[kMax_decoded_messages][kMax_message_length];
+  DECODE_SYNC = 0,
+  DECODE_LDPC,
+  DECODE_DONE
+};
+
+static Decode_Stage decode_stage = DECODE_DONE;
+static Spectrogram decode_spectrogram;
+static time_t decode_slot_time;
+static Candidate candidate_list[kMax_candidates];
+static int num_candidates;
+static bool decoded_candidate[kMax_candidates];
+static size_t pass_idx;
+static int candidate_idx; // next candidate of the current pass
+static int num_tried;     // candidates tried by the current pass
+static char decoded[kMax_decoded_messages][22];
+static Decode decoding[kMax_decoded_messages]; // copied to new_decoded[] at the end
+static int num_decoded;
+
+void ft8_decode_begin(void)
+{
+  decode_spectrogram = {export_fft_power, ft8_ring_blocks,
+                        (int)(decode_start_block % ft8_ring_blocks),
+                        ft8_decode_blocks, ft8_buffer};
+
+  // The decode runs near the end of its slot or early in the next one
+  decode_slot_time = ((now() - 7) / 15) * 15;
+  decode_stage = DECODE_SYNC;
+  num_decoded = 0;
+}
 
+// Check the CRC of a codeword that passed LDPC and add its message
+static void add_decoded(const Candidate &cand, const Bits174 *plain)
+{
   const float fsk_dev = 6.25f; // tone deviation in Hz and symbol rate
+  float freq_hz = (cand.freq_offset + cand.freq_sub / 2.0f) * fsk_dev;
+
+  // Extract payload + CRC (first K bits)
+  uint8_t a91[K_BYTES];
+  pack_bits(plain, K, a91);
+
+  // Extract CRC and check it
+  uint16_t chksum = ((a91[9] & 0x07) << 11) | (a91[10] << 3) | (a91[11] >> 5);
+  a91[9] &= 0xF8;
+  a91[10] = 0;
+  a91[11] = 0;
+  uint16_t chksum2 = crc(a91, 96 - 14);
+  if (chksum != chksum2)
+    return;
+
+  // A valid codeword will not change in a deeper pass
+  decoded_candidate[&cand - candidate_list] = true;
+  trace_instant(TRACE_DECODED, &cand - candidate_list);
+
+  char message[kMax_message_length];
+
+  char call_to[14];
+  char call_from[14];
+  char locator[7];
+  int rc = unpack77_fields(a91, call_to, call_from, locator);
+  if (rc < 0)
+    return;
+
+  sprintf(message, "%s %s %s ", call_to, call_from, locator);
+
+  // Check for duplicate messages (TODO: use hashing)
+  for (int i = 0; i < num_decoded; ++i)
+  {
+    if (0 == strcmp(decoded[i], message))
+      return;
+  }
+
+  if (num_decoded >= kMax_decoded_messages || strlen(message) >= kMax_message_length)
+    return;
 
-  // Go over candidates and attempt to decode messages
-  int num_decoded = 0;
+  strcpy(decoded[num_decoded], message);
 
-  for (int idx = 0; idx < num_candidates; ++idx)
+  Decode *decode = &decoding[num_decoded];
+  decode->sync_score = cand.score;
+  decode->freq_hz = (int)freq_hz;
+  strcpy(decode->call_to, call_to);
+  strcpy(decode->call_from, call_from);
+  strcpy(decode->locator, locator);
+
+  decode->slot = slot_state;
+
+  // Candidate time offsets are relative to the start of the decode window
+  decode->dt_ms = dt_from_candidate(cand.time_offset - ft8_lookback_blocks, cand.time_sub);
+  dt_record(decode->dt_ms, decode_epoch);
+
+  int raw_RSL = (float)cand.score;
+  int display_RSL = (int)((raw_RSL - 235)) / 8;
+  decode->snr = display_RSL;
+  decode->sequence = Seq_RSL;
+
+  decode->target_distance = 0;
+
+  if (validate_locator(locator))
   {
-    Candidate cand = candidate_list[idx];
-    float freq_hz = (cand.freq_offset + cand.freq_sub / 2.0f) * fsk_dev;
-
-    float log174[N];
-    extract_likelihood(export_fft_power, ft8_buffer, cand, kGray_map, log174);
-
-    // bp_decode() produces better decodes, uses way less memory
-    uint8_t plain[N];
-    int n_errors = 0;
-    bp_decode(log174, kLDPC_iterations, plain, &n_errors);
-
-    if (n_errors > 0)
-      continue;
-
-    // Extract payload + CRC (first K bits)
-    uint8_t a91[K_BYTES];
-    pack_bits(plain, K, a91);
-
-    // Extract CRC and check it
-    uint16_t chksum = ((a91[9] & 0x07) << 11) | (a91[10] << 3) | (a91[11] >> 5);
-    a91[9] &= 0xF8;
-    a91[10] = 0;
-    a91[11] = 0;
-    uint16_t chksum2 = crc(a91, 96 - 14);
-    if (chksum != chksum2)
-      continue;
-
-    char message[kMax_message_length];
-
-    char call_to[14];
-    char call_from[14];
-    char locator[7];
-    int rc = unpack77_fields(a91, call_to, call_from, locator);
-    if (rc < 0)
-      continue;
-
-    sprintf(message, "%s %s %s ", call_to, call_from, locator);
-
-    // Check for duplicate messages (TODO: use hashing)
-    bool found = false;
-    for (int i = 0; i < num_decoded; ++i)
+    strcpy(decode->target_locator, locator);
+    decode->sequence = Seq_Locator;
+  }
+  else
+  {
+    const char *ptr = locator;
+    if (*ptr == 'R')
     {
-      if (0 == strcmp(decoded[i], message))
-      {
-        found = true;
-        break;
-      }
+      ptr++;
     }
 
-    int raw_RSL;
-    int display_RSL;
-    int received_RSL;
+    int received_RSL = atoi(ptr);
+    if (received_RSL < 30) // Prevents a 73 being decoded as a received RSL
+    {
+      decode->received_snr = received_RSL;
+    }
+  }
 
-    getTeensy3Time();
-    char rtc_string[10]; // print format stuff
-    sprintf(rtc_string, "%02i%02i%02i", hour(), minute(), second());
+  decode->calling_CQ = (memcmp(decode->call_to, "CQ\0", 3) == 0) || (memcmp(decode->call_to, "CQ ", 3) == 0);
 
-    if (!found && num_decoded < kMax_decoded_messages)
-    {
-      if (strlen(message) < kMax_message_length)
-      {
-        strcpy(decoded[num_decoded], message);
+  // ignore hashed callsigns
+  if (*call_from != '<')
+  {
+    uint32_t frequency = (sBand_Data[BandIndex].Frequency * 1000) + decode->freq_hz;
+    addReceivedRecord(call_from, frequency, display_RSL);
+  }
 
-        new_decoded[num_decoded].sync_score = cand.score;
-        new_decoded[num_decoded].freq_hz = (int)freq_hz;
-        strcpy(new_decoded[num_decoded].call_to, call_to);
-        strcpy(new_decoded[num_decoded].call_from, call_from);
-        strcpy(new_decoded[num_decoded].locator, locator);
+  archive_add(decode_slot_time, sBand_Data[BandIndex].Frequency, decode->freq_hz,
+              decode->dt_ms, display_RSL, a91);
 
-        new_decoded[num_decoded].slot = slot_state;
+  ++num_decoded;
+}
 
-        raw_RSL = (float)cand.score;
-        display_RSL = (int)((raw_RSL - 235)) / 8;
-        new_decoded[num_decoded].snr = display_RSL;
-        new_decoded[num_decoded].sequence = Seq_RSL;
+// LDPC decode the next batch of the current pass, false when the pass has
+// no candidates left
+static bool decode_batch(void)
+{
+  const Decode_Pass &pass = kDecode_passes[pass_idx];
 
-        new_decoded[num_decoded].target_distance = 0;
+  // Gather the next batch of candidates still to be decoded
+  int batch[LDPC_LANES];
+  int batch_size = 0;
+  for (; candidate_idx < num_candidates && num_tried < pass.max_candidates && batch_size < LDPC_LANES; ++candidate_idx)
+  {
+    if (!decoded_candidate[candidate_idx])
+    {
+      batch[batch_size++] = candidate_idx;
+      ++num_tried;
+    }
+  }
 
-        if (validate_locator(locator))
-        {
-          strcpy(new_decoded[num_decoded].target_locator, locator);
-          new_decoded[num_decoded].sequence = Seq_Locator;
-        }
-        else
-        {
-          const char *ptr = locator;
-          if (*ptr == 'R')
-          {
-            ptr++;
-          }
-
-          received_RSL = atoi(ptr);
-          if (received_RSL < 30) // Prevents a 73 being decoded as a received RSL
-          {
-            new_decoded[num_decoded].received_snr = received_RSL;
-          }
-        }
+  if (batch_size == 0)
+    return false;
+
+  float log174[LDPC_LANES][174];
+  for (int b = 0; b < batch_size; ++b)
+  {
+    extract_likelihood(&decode_spectrogram, candidate_list[batch[b]], kGray_map, pass.n_syms, log174[b]);
+  }
 
-        new_decoded[num_decoded].calling_CQ = (memcmp(new_decoded[num_decoded].call_to, "CQ\0", 3) == 0) || (memcmp(new_decoded[num_decoded].call_to, "CQ ", 3) == 0);
+  // bp_decode() produces better decodes, uses way less memory,
+  // the batch version runs it on every candidate of the batch in lockstep
+  Bits174 plain[LDPC_LANES];
+  int n_errors[LDPC_LANES];
+  trace_begin(TRACE_LDPC, batch_size);
+#if LDPC_LANES > 1
+  if (batch_size > 1)
+    bp_decode_batch(log174, batch_size, kLDPC_iterations, plain, n_errors);
+  else
+#endif
+    bp_decode(log174[0], kLDPC_iterations, &plain[0], &n_errors[0]);
+  trace_end(TRACE_LDPC);
+
+  for (int b = 0; b < batch_size; ++b)
+  {
+    if (n_errors[b] == 0)
+      add_decoded(candidate_list[batch[b]], &plain[b]);
+  }
+  return true;
+}
 
-        // ignore hashed callsigns
-        if (*call_from != '<')
-        {
-          uint32_t frequency = (sBand_Data[BandIndex].Frequency * 1000) + new_decoded[num_decoded].freq_hz;
-          addReceivedRecord(call_from, frequency, display_RSL);
-        }
+int ft8_decode_step(void)
+{
+  TRACE_SCOPE(TRACE_DECODE);
 
-        ++num_decoded;
-      }
-    }
-  } // End of big decode loop
+  // Give up rather than decode blocks the FFT has started writing over
+  if (!decode_window_valid())
+    decode_stage = DECODE_DONE;
 
+  switch (decode_stage)
+  {
+  case DECODE_SYNC:
+    // Find top candidates by Costas sync score and localize them in time and frequency
+    num_candidates = find_sync(&decode_spectrogram, kCostas_map, kMax_candidates, candidate_list, kMin_score);
+
+    // Strongest candidates first, so that the deeper passes retry the best leftovers
+    sort_candidates(candidate_list, num_candidates);
+
+    memset(decoded_candidate, 0, sizeof(decoded_candidate));
+    pass_idx = 0;
+    candidate_idx = 0;
+    num_tried = 0;
+    decode_stage = DECODE_LDPC;
+    return -1;
+
+  case DECODE_LDPC:
+    if (decode_batch())
+      return -1;
+
+    // On to the next pass, or finished
+    candidate_idx = 0;
+    num_tried = 0;
+    if (++pass_idx < sizeof(kDecode_passes) / sizeof(kDecode_passes[0]))
+      return -1;
+    decode_stage = DECODE_DONE;
+    break;
+
+  case DECODE_DONE:
+    break;
+  }
+
+  memcpy(new_decoded, decoding, num_decoded * sizeof(Decode));
   return num_decoded;
 }
 
+// Order candidates by descending sync score
+static void sort_candidates(Candidate *candidates, int num_candidates)
+{
+  for (int i = 1; i < num_candidates; ++i)
+  {
+    Candidate cand = candidates[i];
+    int j = i;
+    while (j > 0 && candidates[j - 1].score < cand.score)
+    {
+      candidates[j] = candidates[j - 1];
+      --j;
+    }
+    candidates[j] = cand;
+  }
+}
+
 int validate_locator(const char *QSO_locator)
 {
   const char RR73[4] = {'R', 'R', '7', '3'};
@@ -245,6 +375,8 @@ void process_selected_Station(int stations_decoded, int TouchIndex)
 
 void display_messages(Decode new_decoded[], int decoded_messages)
 {
+  PROFILE_SCOPE(PROFILE_DISPLAY_MESSAGES);
+  TRACE_SCOPE(TRACE_DISPLAY);
   clear_rx_region();
   max_sync_score = 0;
   Valid_CQ_Candidate = 0;
@@ -264,7 +396,7 @@ void display_messages(Decode new_decoded[], int decoded_messages)
     {
       color = Green;
 
-      if (!check_call_list(i) && !check_log_list(i))
+      if (!check_call_list(i) && !worked_before(call_from, BandIndex))
       {
         if (new_decoded[i].sync_score > max_sync_score)
         {
@@ -305,10 +437,8 @@ void store_CQ_Call(void)
   strcpy(call_list[auto_call_limit - 1].call, new_decoded[max_sync_score_index].call_from);
 }
 
-void store_logged_CQ_Call(const char *call)
+void store_logged_CQ_Call(void)
 {
-
-  strcpy(auto_logged_list[auto_logged].call, call); // store candidate call so we do not duplicate call later
   auto_logged++;
   display_value(0, 520, auto_logged);
 }
@@ -316,7 +446,7 @@ void store_logged_CQ_Call(const char *call)
 void clear_auto_memories(void)
 {
 
-  for (int j = 0; j < auto_logged; j++)
+  for (int j = 0; j < auto_call_limit; j++)
   {
     strcpy(call_list[j].call, auto_blank);
     call_list[j].distance = 0.0;
@@ -382,16 +512,33 @@ void display_qso_state(const char *txt)
   display_line(true, 1, Black, White, txt);
 }
 
-char *add_worked_qso(void)
+void add_worked_qso(int band, const char *call, int rx_rsl, int tx_rsl)
 {
+  static const char band_strs[NumBands + 1][4] = {
+      "40", "30", "20", "17", "15", "12", "10", "?"};
+
   // Handle circular buffer overflow - use modulo for array indexing
-  int entry_index = num_qsos % MAX_QSO_ENTRIES;
+  char *buf = worked_qso_entries[num_qsos % MAX_QSO_ENTRIES];
   num_qsos++;
-  return worked_qso_entries[entry_index];
+
+  int printed = snprintf(buf, MAX_LINE_LEN, "%.3s %.12s", band_strs[band], call);
+
+  // Each report is only shown when it fits completely, RX first
+  const int reports[2] = {rx_rsl, tx_rsl};
+  for (int report : reports)
+  {
+    char rsl[RSL_SIZE]; // space + sign + 2 digits + null = 5
+    int needed = snprintf(rsl, sizeof(rsl), " %d", report);
+    if (needed < 0 || needed >= (int)sizeof(rsl) || printed + needed >= MAX_LINE_LEN)
+      break;
+    strcpy(buf + printed, rsl);
+    printed += needed;
+  }
 }
 
 bool display_worked_qsos(void)
 {
+  TRACE_SCOPE(TRACE_DISPLAY);
   // Display in pages
   // pi is page index
   static int pi = 0;
@@ -440,17 +587,3 @@ int check_call_list(int message_index)
   return test;
 }
 
-int check_log_list(int message_index)
-{
-
-  int test = 0;
-
-  for (int i = 0; i < auto_logged; i++)
-  {
-    if (strcmp(auto_logged_list[i].call, new_decoded[message_index].call_from) == 0)
-    {
-      test = 1;
-    }
-  }
-  return test;
-}
@@ -14,6 +14,8 @@
 #include "gen_ft8.h"
 #include "ini.h"
 #include "autoseq_engine.h"
+#include "tx_scheduler.h"
+#include "trace.h"
 
 File stationData_File;
 
@@ -139,6 +141,52 @@ static int setup_free_text(const char *free_text, int field_id)
   return result;
 }
 
+static size_t read_station_data(char *buffer, size_t len, void *source)
+{
+  int bytes_read = ((File *)source)->read(buffer, len);
+  return (bytes_read > 0) ? (size_t)bytes_read : 0;
+}
+
+static void station_data_key(const char *section, const char *key, const char *value, void *user)
+{
+  if (strcmp(section, "Station") == 0)
+  {
+    if (strcmp(key, "Call") == 0)
+      setup_station_call(value);
+    else if (strcmp(key, "Locator") == 0)
+      setup_locator(value);
+  }
+  else if (strcmp(section, "FreeText") == 0)
+  {
+    if (strcmp(key, "1") == 0)
+      setup_free_text(value, FreeText1);
+    else if (strcmp(key, "2") == 0)
+      setup_free_text(value, FreeText2);
+  }
+  else if (strcmp(section, "Transmit") == 0)
+  {
+    if (strcmp(key, "GFSK") == 0)
+      gfsk_shaping = atoi(value) != 0;
+  }
+  else if (strcmp(section, "BandData") == 0)
+  {
+    // see BandIndex
+    static const char *bands[NumBands] = {"40", "30", "20", "17", "15", "12", "10"};
+    for (int idx = _40M; idx <= _10M; ++idx)
+    {
+      if (strcmp(key, bands[idx]) == 0)
+      {
+        size_t band_data_size = strlen(value) + 1;
+        if (band_data_size < BAND_DATA_SIZE)
+        {
+          sBand_Data[idx].Frequency = (uint16_t)(atof(value) * 1000);
+          memcpy(sBand_Data[idx].display, value, band_data_size);
+        }
+      }
+    }
+  }
+}
+
 bool open_stationData_file(void)
 {
   Station_Call[0] = 0;
@@ -147,7 +195,6 @@ bool open_stationData_file(void)
   Free_Text1[0] = 0;
   Free_Text2[0] = 0;
 
-  char read_buffer[256];
   if (!SD.begin(BUILTIN_SDCARD))
   {
     tft.textColor(RED, BLACK);
@@ -158,53 +205,16 @@ bool open_stationData_file(void)
   }
   else
   {
-    size_t bytes_read = 0;
     stationData_File = SD.open("StationData.ini", FILE_READ);
 
     if (stationData_File)
     {
-      stationData_File.seek(0);
-      bytes_read = stationData_File.read(read_buffer, 256);
-      ini_data_t ini_data;
-      parse_ini(read_buffer, bytes_read, &ini_data);
-      const ini_section_t *section = get_ini_section(&ini_data, "Station");
-      if (section != NULL)
-      {
-        setup_station_call(get_ini_value_from_section(section, "Call"));
-        setup_locator(get_ini_value_from_section(section, "Locator"));
-      }
-
-      section = get_ini_section(&ini_data, "FreeText");
-      if (section != NULL)
-      {
-        setup_free_text(get_ini_value_from_section(section, "1"), FreeText1);
-        setup_free_text(get_ini_value_from_section(section, "2"), FreeText2);
-      }
-
-      section = get_ini_section(&ini_data, "BandData");
-      if (section != NULL)
-      {
-        // see BandIndex
-        static const char *bands[NumBands] = {"40", "30", "20", "17", "15", "12", "10"};
-        for (int idx = _40M; idx <= _10M; ++idx)
-        {
-          const char *band_data = get_ini_value_from_section(section, bands[idx]);
-          if (band_data != NULL)
-          {
-            size_t band_data_size = strlen(band_data) + 1;
-            if (band_data_size < BAND_DATA_SIZE)
-            {
-              sBand_Data[idx].Frequency = (uint16_t)(atof(band_data) * 1000);
-              memcpy(sBand_Data[idx].display, band_data, band_data_size);
-            }
-          }
-        }
-      }
-
+      parse_ini(read_station_data, &stationData_File, station_data_key, NULL);
       stationData_File.close();
     }
     else
     {
+      char read_buffer[65] = {0};
       stationData_File = SD.open("StationData.txt", FILE_READ);
 
       if (stationData_File)
@@ -353,6 +363,7 @@ void update_message_log_display(int mode)
 
 void display_logged_messages(void)
 {
+  TRACE_SCOPE(TRACE_DISPLAY);
   clear_qso_region();
 
   for (int i = 0; i < max_log_messages; i++)
@@ -0,0 +1,137 @@
+#include <Arduino.h>
+
+#include "dt_estimator.h"
+
+// Clock offset estimation from the DT of decoded signals.
+// The median over the most recent decodes is robust against the odd
+// station with a bad clock, and a correction is only applied when enough
+// decodes agree that our slot timing is off.
+
+static const int kDT_samples = 32;      // decodes kept for the median
+static const int kDT_min_samples = 5;   // decodes needed before correcting
+static const int kDT_deadband_ms = 100; // median offsets smaller than this are left alone
+static const int kDT_max_step_ms = 100; // largest correction applied per slot
+static const int kDT_history = 16;      // corrections kept for display
+
+struct DT_Correction
+{
+  uint32_t time;
+  int16_t median_ms;
+  int16_t step_ms;
+  uint8_t samples;
+};
+
+static int16_t dt_samples[kDT_samples]; // relative to the timing after every correction so far
+static int dt_count = 0;
+static int dt_next = 0;
+
+static uint16_t dt_syncs = 0;
+static int32_t dt_applied_ms = 0;   // corrections added to start_time
+static int32_t dt_corrected_ms = 0; // corrections worked out, some may still be pending
+
+static DT_Correction dt_history[kDT_history];
+static int dt_history_count = 0;
+
+int dt_from_candidate(int block, int time_sub)
+{
+  return block * FT8_BLOCK_MS + time_sub * (FT8_BLOCK_MS / 2) - FT8_TX_START_MS;
+}
+
+DT_Epoch dt_epoch(void)
+{
+  return {dt_syncs, dt_applied_ms};
+}
+
+void dt_record(int dt_ms, DT_Epoch epoch)
+{
+  if (epoch.sync != dt_syncs)
+    return;
+
+  // Take off the corrections the window was not captured under
+  dt_samples[dt_next] = (int16_t)(dt_ms - (dt_corrected_ms - epoch.applied_ms));
+  dt_next = (dt_next + 1) % kDT_samples;
+  if (dt_count < kDT_samples)
+    dt_count++;
+}
+
+static int dt_median(void)
+{
+  int16_t sorted[kDT_samples];
+  for (int i = 0; i < dt_count; i++)
+  {
+    int16_t value = dt_samples[i];
+    int j = i;
+    while (j > 0 && sorted[j - 1] > value)
+    {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = value;
+  }
+
+  if (dt_count % 2)
+    return sorted[dt_count / 2];
+
+  return (sorted[dt_count / 2 - 1] + sorted[dt_count / 2]) / 2;
+}
+
+int dt_end_of_slot(void)
+{
+  if (dt_count < kDT_min_samples)
+    return 0;
+
+  int median = dt_median();
+  if (median > -kDT_deadband_ms && median < kDT_deadband_ms)
+    return 0;
+
+  // Move half way towards the median each slot so that a single
+  // burst of odd decodes cannot throw the timing around
+  int step = median / 2;
+  if (step > kDT_max_step_ms)
+    step = kDT_max_step_ms;
+  else if (step < -kDT_max_step_ms)
+    step = -kDT_max_step_ms;
+
+  // Keep the samples consistent with the corrected timing
+  for (int i = 0; i < dt_count; i++)
+    dt_samples[i] -= step;
+  dt_corrected_ms += step;
+
+  DT_Correction *entry = &dt_history[dt_history_count % kDT_history];
+  entry->time = millis();
+  entry->median_ms = median;
+  entry->step_ms = step;
+  entry->samples = dt_count;
+  dt_history_count++;
+
+  Serial.printf("DT correction %+d ms (median %+d ms over %d decodes)\n", step, median, dt_count);
+
+  return step;
+}
+
+void dt_applied(int step_ms)
+{
+  dt_applied_ms += step_ms;
+}
+
+void dt_reset(void)
+{
+  dt_count = 0;
+  dt_next = 0;
+  dt_syncs++;
+  dt_applied_ms = 0;
+  dt_corrected_ms = 0;
+}
+
+void dt_print_history(void)
+{
+  int first = dt_history_count > kDT_history ? dt_history_count - kDT_history : 0;
+
+  Serial.printf("DT corrections: %d, samples: %d\n", dt_history_count, dt_count);
+  for (int i = first; i < dt_history_count; i++)
+  {
+    const DT_Correction *entry = &dt_history[i % kDT_history];
+    Serial.printf("%10lu ms: %+4d ms (median %+4d ms, %u decodes)\n",
+                  (unsigned long)entry->time, entry->step_ms, entry->median_ms, entry->samples);
+  }
+}
@@ -10,15 +10,6 @@
 #include "encode.h"
 #include "constants.h"
 
-// Returns 1 if an odd number of bits are set in x, zero otherwise
-static uint8_t parity8(uint8_t x)
-{
-  x ^= x >> 4; // a b c d ae bf cg dh
-  x ^= x >> 2; // a b ac bd cae dbf aecg bfdh
-  x ^= x >> 1; // a ab bac acbd bdcae caedbf aecgbfdh
-  return (x) & 1;
-}
-
 // Encode a 91-bit message and return a 174-bit codeword.
 // The generator matrix has dimensions (87,87).
 // The code is a (174,91) regular ldpc code with column weight 3.
@@ -41,23 +32,26 @@ void encode174(const uint8_t *message, uint8_t *codeword)
     codeword[j] = (j < K_BYTES) ? message[j] : 0;
   }
 
+  // The message as big-endian 32-bit words, matching kGenerator_words
+  uint32_t words[3] = {0, 0, 0};
+  for (int j = 0; j < K_BYTES; ++j)
+  {
+    words[j / 4] |= (uint32_t)message[j] << (24 - 8 * (j % 4));
+  }
+
   uint8_t col_mask = (0x80 >> (K % 8)); // bitmask of current byte
   uint8_t col_idx = K_BYTES - 1;        // index into byte array
 
   // Compute the first part of itmp (1:M) and store the result in codeword
   for (int i = 0; i < M; ++i)
   { // do i=1,M
-    // Fast implementation of bitwise multiplication and parity checking
-    // Normally nsum would contain the result of dot product between message and kGenerator[i],
-    // but we only compute the sum modulo 2.
-    uint8_t nsum = 0;
-    for (int j = 0; j < K_BYTES; ++j)
-    {
-      uint8_t bits = message[j] & kGenerator[i][j]; // bitwise AND (bitwise multiplication)
-      nsum ^= parity8(bits);                        // bitwise XOR (addition modulo 2)
-    }
+    // The dot product between message and kGenerator[i] modulo 2
+    // is the parity of the bitwise AND of the two
+    const uint32_t *row = kGenerator_words.rows[i];
+    uint32_t bits = (words[0] & row[0]) ^ (words[1] & row[1]) ^ (words[2] & row[2]);
+
     // Check if we need to set a bit in codeword
-    if (nsum % 2)
+    if (__builtin_parity(bits))
     { // pchecks(i)=mod(nsum,2)
       codeword[col_idx] |= col_mask;
     }
@@ -76,30 +70,34 @@ void encode174(const uint8_t *message, uint8_t *codeword)
 // [IN] num_bits - number of bits in the sequence
 uint16_t crc(uint8_t *message, int num_bits)
 {
-  // Adapted from https://barrgroup.com/Embedded-Systems/How-To/CRC-Calculation-C-Code
-  uint16_t TOPBIT = (1 << (CRC_WIDTH - 1));
-
   uint16_t remainder = 0;
-  int idx_byte = 0;
 
-  // Perform modulo-2 division, a bit at a time.
-  for (int idx_bit = 0; idx_bit < num_bits; ++idx_bit)
+  // Whole bytes a byte at a time through the lookup table
+  int num_bytes = num_bits / 8;
+  for (int idx_byte = 0; idx_byte < num_bytes; ++idx_byte)
   {
-    if (idx_bit % 8 == 0)
-    {
-      // Bring the next byte into the remainder.
-      remainder ^= (message[idx_byte] << (CRC_WIDTH - 8));
-      ++idx_byte;
-    }
+    uint8_t index = (uint8_t)((remainder >> (CRC_WIDTH - 8)) ^ message[idx_byte]);
+    remainder = (remainder << 8) ^ kCrc_table.values[index];
+  }
 
-    // Try to divide the current data bit.
-    if (remainder & TOPBIT)
-    {
-      remainder = (remainder << 1) ^ CRC_POLYNOMIAL;
-    }
-    else
+  // Then any remaining bits one at a time
+  // Adapted from https://barrgroup.com/Embedded-Systems/How-To/CRC-Calculation-C-Code
+  int remaining_bits = num_bits % 8;
+  if (remaining_bits)
+  {
+    const uint16_t TOPBIT = (1 << (CRC_WIDTH - 1));
+
+    remainder ^= (message[num_bytes] << (CRC_WIDTH - 8));
+    for (int idx_bit = 0; idx_bit < remaining_bits; ++idx_bit)
     {
-      remainder = (remainder << 1);
+      if (remainder & TOPBIT)
+      {
+        remainder = (remainder << 1) ^ CRC_POLYNOMIAL;
+      }
+      else
+      {
+        remainder = (remainder << 1);
+      }
     }
   }
   return remainder & ((1 << CRC_WIDTH) - 1);
@@ -55,11 +55,58 @@ void erase_CQ(void)
   tft.write(CQ_message, 18);
 }
 
+// Packed payloads and tone sequences of recently queued messages, so that
+// autoseq can encode a whole QSO up front and switch between its messages
+// without running pack77() and genft8() at the slot boundary
+#define TX_CACHE_SIZE 8
+
+typedef struct
+{
+  char text[MESSAGE_SIZE];
+  uint8_t packed[12]; // 77 bits of payload (K_BYTES)
+  uint8_t tones[79];  // NN channel symbols
+  uint32_t last_used;
+} tx_cache_entry_t;
+
+static tx_cache_entry_t tx_cache[TX_CACHE_SIZE];
+static uint32_t tx_cache_clock;
+
+const uint8_t *tx_tones = tx_cache[0].tones;
+
+static tx_cache_entry_t *lookup_tx_cache(const char *tx_msg)
+{
+  tx_cache_entry_t *victim = NULL;
+
+  for (int i = 0; i < TX_CACHE_SIZE; ++i)
+  {
+    tx_cache_entry_t *entry = &tx_cache[i];
+    if (entry->last_used && strncmp(entry->text, tx_msg, MESSAGE_SIZE) == 0)
+    {
+      entry->last_used = ++tx_cache_clock;
+      return entry;
+    }
+
+    // Never evict the sequence that may be on the air
+    if (entry->tones != tx_tones && (!victim || entry->last_used < victim->last_used))
+      victim = entry;
+  }
+
+  strncpy(victim->text, tx_msg, MESSAGE_SIZE - 1);
+  victim->text[MESSAGE_SIZE - 1] = 0;
+  pack77(victim->text, victim->packed);
+  genft8(victim->packed, victim->tones);
+  victim->last_used = ++tx_cache_clock;
+
+  return victim;
+}
+
+void cache_custom_text(const char *tx_msg)
+{
+  lookup_tx_cache(tx_msg);
+}
+
 // Needed by autoseq_engine
 void queue_custom_text(const char *tx_msg)
 {
-  uint8_t packed[K_BYTES];
-
-  pack77(tx_msg, packed);
-  genft8(packed, tones);
+  tx_tones = lookup_tx_cache(tx_msg)->tones;
 }
@@ -0,0 +1,45 @@
+#include <math.h>
+
+#include "gfsk.h"
+
+float gfsk_pulse(float t)
+{
+  const float c = (float)M_PI * sqrtf(2.0f / logf(2.0f));
+  return 0.5f * (erff(c * GFSK_BT * (t + 0.5f)) - erff(c * GFSK_BT * (t - 0.5f)));
+}
+
+// At BT = 2.0 the pulse has died away beyond the neighbouring symbols, and
+// the first and last tones are held at the ends as WSJT-X does
+void gfsk_levels(const uint8_t tones[TX_SYMBOLS], int levels_per_tone, uint8_t levels[TX_SYMBOLS * GFSK_STEPS])
+{
+  static float weights[GFSK_STEPS][3];
+  static bool weights_ready = false;
+
+  if (!weights_ready)
+  {
+    for (int j = 0; j < GFSK_STEPS; ++j)
+    {
+      float t = (j + 0.5f) / GFSK_STEPS - 0.5f;
+      float sum = 0;
+      for (int d = 0; d < 3; ++d)
+      {
+        weights[j][d] = gfsk_pulse(t - (d - 1));
+        sum += weights[j][d];
+      }
+      for (int d = 0; d < 3; ++d)
+        weights[j][d] /= sum;
+    }
+    weights_ready = true;
+  }
+
+  for (int k = 0; k < TX_SYMBOLS; ++k)
+  {
+    int prev = tones[k > 0 ? k - 1 : k];
+    int next = tones[k < TX_SYMBOLS - 1 ? k + 1 : k];
+    for (int j = 0; j < GFSK_STEPS; ++j)
+    {
+      float tone = weights[j][0] * prev + weights[j][1] * tones[k] + weights[j][2] * next;
+      levels[k * GFSK_STEPS + j] = (uint8_t)lrintf(tone * levels_per_tone);
+    }
+  }
+}
@@ -20,11 +20,23 @@
 #include <math.h>
 
 #include "constants.h"
+#include "ldpc.h"
+#include "profile.h"
+
+static const int kNum_edges = sizeof(kTanner_graph.edge_bits) / sizeof(kTanner_graph.edge_bits[0]);
 
 static int ldpc_check(uint8_t codeword[]);
 static float fast_tanh(float x);
 static float fast_atanh(float x);
 
+#if LDPC_LANES > 1
+// One float per candidate of a batch, held in SIMD registers
+typedef float lanes_t __attribute__((vector_size(LDPC_LANES * sizeof(float))));
+
+static lanes_t fast_tanh(lanes_t x);
+static lanes_t fast_atanh(lanes_t x);
+#endif
+
 // Packs a string of bits each represented as a zero/non-zero byte in plain[],
 // as a string of packed bits starting from the MSB of the first byte of packed[]
 void pack_bits(const uint8_t plain[], int num_bits, uint8_t packed[])
@@ -52,50 +64,71 @@ void pack_bits(const uint8_t plain[], int num_bits, uint8_t packed[])
   }
 }
 
+void pack_bits(const Bits174 *plain, int num_bits, uint8_t packed[])
+{
+  int num_bytes = (num_bits + 7) / 8;
+  for (int i = 0; i < num_bytes; ++i)
+  {
+    packed[i] = (uint8_t)(plain->word[i / 8] >> (56 - 8 * (i % 8)));
+  }
+
+  // Clear the bits beyond num_bits in the last byte
+  if (num_bits % 8)
+  {
+    packed[num_bytes - 1] &= (uint8_t)(0xFF << (8 - num_bits % 8));
+  }
+}
+
 // codeword is 174 log-likelihoods.
 // plain is a return value, 174 ints, to be 0 or 1.
 // max_iters is how hard to try.
-// ok == 87 means success.
+// ok == 0 means success.
+// Messages are kept per edge of the Tanner graph like bp_decode(), the dense
+// m[M][N] and e[M][N] matrices cost ~116 kB of stack for 522 used entries.
+static const float kMax_tanh = 0.999999f;
+
 void ldpc_decode(float *codeword, int max_iters, uint8_t plain[], int *ok)
 {
-  float m[M][N]; // ~60 kB
-  float e[M][N]; // ~60 kB
+  const Tanner_Graph &graph = kTanner_graph;
+  float m[kNum_edges]; // bit to check messages
+  float e[kNum_edges]; // check to bit messages
   int min_errors = M;
 
-  for (int j = 0; j < M; j++)
+  for (int k = 0; k < kNum_edges; k++)
   {
-    for (int i = 0; i < N; i++)
-    {
-      m[j][i] = codeword[i];
-      e[j][i] = 0.0f;
-    }
+    m[k] = codeword[graph.edge_bits[k]];
+    e[k] = 0.0f;
   }
 
   for (int iter = 0; iter < max_iters; iter++)
   {
     for (int j = 0; j < M; j++)
     {
-      for (int ii1 = 0; ii1 < kNrw[j]; ii1++)
+      int first = graph.check_edges[j];
+      int last = graph.check_edges[j + 1];
+      for (int k1 = first; k1 < last; k1++)
       {
-        int i1 = kNm[j][ii1] - 1;
         float a = 1.0f;
-        for (int ii2 = 0; ii2 < kNrw[j]; ii2++)
+        for (int k2 = first; k2 < last; k2++)
         {
-          int i2 = kNm[j][ii2] - 1;
-          if (i2 != i1)
+          if (k2 != k1)
           {
-            a *= fast_tanh(-m[j][i2] / 2.0f);
+            a *= fast_tanh(-m[k2] / 2.0f);
           }
         }
-        e[j][i1] = logf((1 - a) / (1 + a));
+        // fast_tanh() saturates at +-1, which would make the message infinite
+        // and the bit sums NaN, decoding as the all-zero codeword
+        a = fminf(fmaxf(a, -kMax_tanh), kMax_tanh);
+        e[k1] = logf((1 - a) / (1 + a));
       }
     }
 
     for (int i = 0; i < N; i++)
     {
+      const uint16_t *edges = graph.bit_edges[i];
       float l = codeword[i];
       for (int j = 0; j < 3; j++)
-        l += e[kMn[i][j] - 1][i];
+        l += e[edges[j]];
       plain[i] = (l > 0) ? 1 : 0;
     }
 
@@ -114,19 +147,18 @@ void ldpc_decode(float *codeword, int max_iters, uint8_t plain[], int *ok)
 
     for (int i = 0; i < N; i++)
     {
+      const uint16_t *edges = graph.bit_edges[i];
       for (int ji1 = 0; ji1 < 3; ji1++)
       {
-        int j1 = kMn[i][ji1] - 1;
         float l = codeword[i];
         for (int ji2 = 0; ji2 < 3; ji2++)
         {
           if (ji1 != ji2)
           {
-            int j2 = kMn[i][ji2] - 1;
-            l += e[j2][i];
+            l += e[edges[ji2]];
           }
         }
-        m[j1][i] = l;
+        m[edges[ji1]] = l;
       }
     }
   }
@@ -158,28 +190,35 @@ static int ldpc_check(uint8_t codeword[])
   return errors;
 }
 
-void bp_decode(float codeword[], int max_iters, uint8_t plain[], int *ok)
+// Same as above on a packed codeword, each check is an AND and a parity
+int ldpc_check(const Bits174 *codeword)
 {
-  float tov[N][3];
-  float toc[M][7];
-
-  int min_errors = M;
-
-  // initialize messages to checks
-  for (int i = 0; i < M; ++i)
+  int errors = 0;
+  for (int j = 0; j < M; ++j)
   {
-    for (int j = 0; j < kNrw[i]; ++j)
-    {
-      toc[i][j] = codeword[kNm[i][j] - 1];
-    }
+    const uint64_t *mask = kTanner_graph.check_masks[j];
+    uint64_t x = (codeword->word[0] & mask[0]) ^
+                 (codeword->word[1] & mask[1]) ^
+                 (codeword->word[2] & mask[2]);
+    errors += __builtin_parityll(x);
   }
+  return errors;
+}
 
-  for (int i = 0; i < N; ++i)
+// Messages are kept per edge of the Tanner graph (see kTanner_graph), so both
+// directions of message passing are plain indexed loads.
+void bp_decode(float codeword[], int max_iters, Bits174 *plain, int *ok)
+{
+  PROFILE_SCOPE(PROFILE_BP_DECODE);
+  const Tanner_Graph &graph = kTanner_graph;
+  float tov[kNum_edges]; // check to bit messages
+  float toc[kNum_edges]; // bit to check messages
+
+  int min_errors = M;
+
+  for (int e = 0; e < kNum_edges; ++e)
   {
-    for (int j = 0; j < 3; ++j)
-    {
-      tov[i][j] = 0;
-    }
+    tov[e] = 0;
   }
 
   for (int iter = 0; iter < max_iters; ++iter)
@@ -187,10 +226,15 @@ void bp_decode(float codeword[], int max_iters, uint8_t plain[], int *ok)
     float zn[N];
 
     // Update bit log likelihood ratios (tov=0 in iter 0)
+    plain->word[0] = plain->word[1] = plain->word[2] = 0;
     for (int i = 0; i < N; ++i)
     {
-      zn[i] = codeword[i] + tov[i][0] + tov[i][1] + tov[i][2];
-      plain[i] = (zn[i] > 0) ? 1 : 0;
+      const uint16_t *edges = graph.bit_edges[i];
+      zn[i] = codeword[i] + tov[edges[0]] + tov[edges[1]] + tov[edges[2]];
+      if (zn[i] > 0)
+      {
+        plain->word[i / 64] |= 1ULL << (63 - i % 64);
+      }
     }
 
     // Check to see if we have a codeword (check before we do any iter)
@@ -207,54 +251,144 @@ void bp_decode(float codeword[], int max_iters, uint8_t plain[], int *ok)
       }
     }
 
-    // Send messages from bits to check nodes
+    // Send messages from bits to check nodes,
+    // subtracting off what the bit had received from the check
+    for (int e = 0; e < kNum_edges; ++e)
+    {
+      toc[e] = fast_tanh(-(zn[graph.edge_bits[e]] - tov[e]) / 2);
+    }
+
+    // send messages from check nodes to variable nodes
     for (int i = 0; i < M; ++i)
     {
-      for (int j = 0; j < kNrw[i]; ++j)
+      int first = graph.check_edges[i];
+      int last = graph.check_edges[i + 1];
+      for (int e = first; e < last; ++e)
       {
-        int ibj = kNm[i][j] - 1;
-        toc[i][j] = zn[ibj];
-        for (int kk = 0; kk < 3; ++kk)
+        float Tmn = 1.0f;
+        for (int k = first; k < last; ++k)
         {
-          // subtract off what the bit had received from the check
-          if (kMn[ibj][kk] - 1 == i)
+          if (k != e)
           {
-            toc[i][j] -= tov[ibj][kk];
+            Tmn *= toc[k];
           }
         }
+        tov[e] = 2 * fast_atanh(-Tmn);
       }
     }
+  }
 
-    // send messages from check nodes to variable nodes
-    for (int i = 0; i < M; ++i)
+  *ok = min_errors;
+}
+
+#if LDPC_LANES > 1
+void bp_decode_batch(float codewords[][174], int num_codewords, int max_iters, Bits174 plain[], int ok[])
+{
+  PROFILE_SCOPE(PROFILE_BP_DECODE);
+  const Tanner_Graph &graph = kTanner_graph;
+  lanes_t codeword[N];
+  lanes_t tov[kNum_edges]; // check to bit messages
+  lanes_t toc[kNum_edges]; // bit to check messages
+  bool done[LDPC_LANES];
+
+  // Unused lanes decode an all-zero codeword alongside the others
+  for (int i = 0; i < N; ++i)
+  {
+    for (int lane = 0; lane < LDPC_LANES; ++lane)
     {
-      for (int j = 0; j < kNrw[i]; ++j)
+      codeword[i][lane] = (lane < num_codewords) ? codewords[lane][i] : 0.0f;
+    }
+  }
+
+  for (int lane = 0; lane < LDPC_LANES; ++lane)
+  {
+    done[lane] = (lane >= num_codewords);
+    if (lane < num_codewords)
+    {
+      ok[lane] = M;
+    }
+  }
+
+  for (int e = 0; e < kNum_edges; ++e)
+  {
+    tov[e] = lanes_t{};
+  }
+
+  for (int iter = 0; iter < max_iters; ++iter)
+  {
+    lanes_t zn[N];
+
+    // Update bit log likelihood ratios (tov=0 in iter 0)
+    for (int i = 0; i < N; ++i)
+    {
+      const uint16_t *edges = graph.bit_edges[i];
+      zn[i] = codeword[i] + tov[edges[0]] + tov[edges[1]] + tov[edges[2]];
+    }
+
+    // Check each lane that is still running, results of finished lanes are kept
+    bool all_done = true;
+    for (int lane = 0; lane < num_codewords; ++lane)
+    {
+      if (done[lane])
+      {
+        continue;
+      }
+
+      Bits174 *bits = &plain[lane];
+      bits->word[0] = bits->word[1] = bits->word[2] = 0;
+      for (int i = 0; i < N; ++i)
       {
-        toc[i][j] = fast_tanh(-toc[i][j] / 2);
+        if (zn[i][lane] > 0)
+        {
+          bits->word[i / 64] |= 1ULL << (63 - i % 64);
+        }
       }
+
+      int errors = ldpc_check(bits);
+      if (errors < ok[lane])
+      {
+        ok[lane] = errors;
+      }
+
+      done[lane] = (errors == 0);
+      all_done = all_done && done[lane];
     }
 
-    for (int i = 0; i < N; ++i)
+    if (all_done)
+    {
+      break;
+    }
+
+    // Send messages from bits to check nodes,
+    // subtracting off what the bit had received from the check
+    for (int e = 0; e < kNum_edges; ++e)
+    {
+      toc[e] = fast_tanh(-(zn[graph.edge_bits[e]] - tov[e]) / 2);
+    }
+
+    // send messages from check nodes to variable nodes
+    for (int i = 0; i < M; ++i)
     {
-      for (int j = 0; j < 3; ++j)
+      int first = graph.check_edges[i];
+      int last = graph.check_edges[i + 1];
+      for (int e = first; e < last; ++e)
       {
-        int ichk = kMn[i][j] - 1; // kMn(:,j) are the checks that include bit j
-        float Tmn = 1.0f;
-        for (int k = 0; k < kNrw[ichk]; ++k)
+        lanes_t Tmn = lanes_t{} + 1.0f;
+        for (int k = first; k < last; ++k)
         {
-          if (kNm[ichk][k] - 1 != i)
+          if (k != e)
           {
-            Tmn *= toc[ichk][k];
+            Tmn *= toc[k];
           }
         }
-        tov[i][j] = 2 * fast_atanh(-Tmn);
+        tov[e] = 2 * fast_atanh(-Tmn);
       }
     }
   }
-
-  *ok = min_errors;
 }
 
+#endif
+
 // https://varietyofsound.wordpress.com/2011/02/14/efficient-tanh-computation-using-lamberts-continued-fraction/
 // http://functions.wolfram.com/ElementaryFunctions/ArcTanh/10/0001/
 // https://mathr.co.uk/blog/2017-09-06_approximating_hyperbolic_tangent.html
@@ -284,3 +418,25 @@ static float fast_atanh(float x)
   float b = (945.0f + x2 * (-1050.0f + x2 * 225.0f));
   return a / b;
 }
+
+#if LDPC_LANES > 1
+// Lane-wise versions of the above
+static lanes_t fast_tanh(lanes_t x)
+{
+  lanes_t x2 = x * x;
+  lanes_t a = x * (945.0f + x2 * (105.0f + x2));
+  lanes_t b = 945.0f + x2 * (420.0f + x2 * 15.0f);
+  lanes_t y = a / b;
+  y = (x < -4.97f) ? -1.0f + lanes_t{} : y;
+  y = (x > 4.97f) ? 1.0f + lanes_t{} : y;
+  return y;
+}
+
+static lanes_t fast_atanh(lanes_t x)
+{
+  lanes_t x2 = x * x;
+  lanes_t a = x * (945.0f + x2 * (-735.0f + x2 * 64.0f));
+  lanes_t b = (945.0f + x2 * (-1050.0f + x2 * 225.0f));
+  return a / b;
+}
+#endif
@@ -0,0 +1,158 @@
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+
+#include <SD.h>
+#include <TimeLib.h>
+
+#include "log_import.h"
+#include "adif_reader.h"
+#include "ADIF.h"
+#include "button.h"
+#include "decode_ft8.h"
+#include "worked_before.h"
+
+#define IMPORT_CHUNK 512 // bytes parsed per step, about a millisecond of SD time
+
+static File import_dir;
+static File import_log;
+static bool import_active = false;
+static bool import_worked_before = false;
+static time_t import_start; // QSOs from this session are already in place
+static int import_count = 0;
+static Adif_Reader import_reader;
+
+// BandIndex from the frequency in MHz, else from a band such as 20m
+static int band_of(const Adif_Record *record)
+{
+  static const int band_meters[NumBands] = {40, 30, 20, 17, 15, 12, 10};
+
+  if (record->freq[0] != 0)
+  {
+    int mhz = atoi(record->freq);
+    for (int idx = _40M; idx <= _10M; ++idx)
+    {
+      if (sBand_Data[idx].Frequency / 1000 == mhz)
+        return idx;
+    }
+  }
+  else if (record->band[0] != 0)
+  {
+    int meters = atoi(record->band);
+    for (int idx = _40M; idx <= _10M; ++idx)
+    {
+      if (band_meters[idx] == meters)
+        return idx;
+    }
+  }
+  return NumBands;
+}
+
+// Start of the QSO from YYYYMMDD and HHMM[SS]
+static time_t time_of(const Adif_Record *record)
+{
+  if (record->qso_date[0] == 0)
+    return 0;
+
+  unsigned long date = strtoul(record->qso_date, NULL, 10);
+  unsigned long time = strtoul(record->time_on, NULL, 10);
+  if (strlen(record->time_on) <= 4)
+    time *= 100;
+
+  tmElements_t tm;
+  tm.Year = CalendarYrToTm(date / 10000);
+  tm.Month = (date / 100) % 100;
+  tm.Day = date % 100;
+  tm.Hour = time / 10000;
+  tm.Minute = (time / 100) % 100;
+  tm.Second = time % 100;
+  return makeTime(tm);
+}
+
+static void import_record(const Adif_Record *record, void *user)
+{
+  time_t start = time_of(record);
+  if (start >= import_start)
+    return;
+
+  int band = band_of(record);
+
+  if (import_worked_before)
+    worked_before_import(record->call, band, (uint16_t)elapsedDays(start));
+
+  char locator[7];
+  strncpy(locator, record->gridsquare, sizeof(locator) - 1);
+  locator[sizeof(locator) - 1] = 0;
+  if (locator[0] != 0)
+    add_map_entry(locator);
+
+  add_worked_qso(band, record->call, atoi(record->rst_rcvd), atoi(record->rst_sent));
+  import_count++;
+}
+
+static bool is_log(File &entry)
+{
+  const char *name = entry.name();
+  size_t len = strlen(name);
+  return !entry.isDirectory() && len > 4 && strcasecmp(name + len - 4, ".adi") == 0;
+}
+
+static void import_finished(void)
+{
+  import_dir.close();
+  if (import_worked_before)
+    worked_before_import_done();
+  import_active = false;
+  Serial.printf("Imported %d QSOs from the logs\n", import_count);
+}
+
+void log_import_begin(bool rebuild_worked_before)
+{
+  import_dir = SD.open("/");
+  import_active = (bool)import_dir;
+  import_worked_before = rebuild_worked_before;
+  import_start = now();
+  import_count = 0;
+
+  if (!import_active && rebuild_worked_before)
+    worked_before_import_done();
+}
+
+bool log_import_pending(void)
+{
+  return import_active;
+}
+
+void log_import_step(void)
+{
+  if (!import_log)
+  {
+    File entry = import_dir.openNextFile();
+    if (!entry)
+    {
+      import_finished();
+    }
+    else if (is_log(entry))
+    {
+      import_log = entry;
+      adif_reader_init(&import_reader, import_record, NULL);
+    }
+    else
+    {
+      entry.close();
+    }
+    return;
+  }
+
+  char chunk[IMPORT_CHUNK];
+  int bytes_read = import_log.read(chunk, sizeof(chunk));
+  if (bytes_read > 0)
+  {
+    adif_reader_feed(&import_reader, chunk, bytes_read);
+  }
+  else
+  {
+    import_log.close();
+    import_log = File();
+  }
+}
@@ -0,0 +1,160 @@
+#include <string.h>
+
+#include "log_journal.h"
+
+#define JOURNAL_MAGIC 0x4C4E524Au // "JRNL"
+
+enum Journal_State
+{
+  JOURNAL_EMPTY = 0,
+  JOURNAL_PENDING,
+  JOURNAL_COMMITTED
+};
+
+struct Journal_Header
+{
+  uint32_t magic;
+  uint32_t state;
+  uint32_t sequence;
+  char file_name[JOURNAL_NAME_SIZE];
+  uint32_t offset; // size of the log before the lines were appended
+  uint32_t length;
+  uint32_t crc;
+};
+
+static uint32_t crc32(const char *data, size_t len)
+{
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < len; i++)
+  {
+    crc ^= (uint8_t)data[i];
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+  }
+  return ~crc;
+}
+
+static bool write_header(const Journal_Files *files, void *journal, const Journal_Header *header)
+{
+  bool ok = files->write(journal, 0, header, sizeof(*header)) == sizeof(*header);
+  files->sync(journal);
+  return ok;
+}
+
+// Append the lines at header->offset, cutting off whatever an interrupted
+// earlier attempt left behind
+static bool apply(const Journal_Files *files, void *log, const Journal_Header *header, const char *data)
+{
+  if (files->size(log) > header->offset)
+    files->truncate(log, header->offset);
+
+  bool ok = files->write(log, files->size(log), data, header->length) == header->length;
+  files->sync(log);
+  return ok;
+}
+
+void journal_init(Journal *journal, const Journal_Files *files, const char *name)
+{
+  journal->files = files;
+  journal->name = name;
+  journal->sequence = 0;
+  journal->retry_offset = -1;
+}
+
+uint32_t journal_replay(Journal *journal, char *scratch, char file_name[JOURNAL_NAME_SIZE])
+{
+  const Journal_Files *files = journal->files;
+  void *jnl = files->open(journal->name);
+  if (jnl == NULL)
+    return 0;
+
+  // Allocate the whole journal once, later appends never change its size
+  if (files->size(jnl) < JOURNAL_SIZE)
+  {
+    static const uint8_t zeros[64] = {0};
+    while (files->size(jnl) < JOURNAL_SIZE)
+    {
+      if (files->write(jnl, files->size(jnl), zeros, sizeof(zeros)) == 0)
+        break;
+    }
+    files->sync(jnl);
+    files->close(jnl);
+    return 0;
+  }
+
+  uint32_t replayed = 0;
+  Journal_Header header;
+  if (files->read(jnl, 0, &header, sizeof(header)) == sizeof(header) && header.magic == JOURNAL_MAGIC)
+  {
+    journal->sequence = header.sequence;
+
+    if (header.state == JOURNAL_PENDING && header.length <= JOURNAL_MAX_DATA)
+    {
+      header.file_name[sizeof(header.file_name) - 1] = 0;
+      void *log = NULL;
+      if (files->read(jnl, JOURNAL_DATA, scratch, header.length) == header.length &&
+          crc32(scratch, header.length) == header.crc)
+        log = files->open(header.file_name);
+
+      if (log != NULL)
+      {
+        if (apply(files, log, &header, scratch))
+        {
+          header.state = JOURNAL_COMMITTED;
+          write_header(files, jnl, &header);
+          strcpy(file_name, header.file_name);
+          replayed = header.length;
+        }
+        files->close(log);
+      }
+    }
+  }
+  files->close(jnl);
+  return replayed;
+}
+
+bool journal_append(Journal *journal, const char *log_name, const char *data, uint32_t len)
+{
+  const Journal_Files *files = journal->files;
+  if (len > JOURNAL_MAX_DATA || strlen(log_name) >= JOURNAL_NAME_SIZE)
+    return false;
+
+  // Without the journal a power loss could leave half the lines in the log
+  void *jnl = files->open(journal->name);
+  if (jnl == NULL)
+    return false;
+
+  void *log = files->open(log_name);
+  if (log == NULL)
+  {
+    files->close(jnl);
+    return false;
+  }
+
+  Journal_Header header = {};
+  header.magic = JOURNAL_MAGIC;
+  header.state = JOURNAL_PENDING;
+  header.sequence = ++journal->sequence;
+  strcpy(header.file_name, log_name);
+  header.offset = (journal->retry_offset >= 0) ? (uint32_t)journal->retry_offset : files->size(log);
+  header.length = len;
+  header.crc = crc32(data, len);
+
+  // The lines must be on the card before the header says so
+  bool ok = files->write(jnl, JOURNAL_DATA, data, len) == len;
+  files->sync(jnl);
+  ok = ok && write_header(files, jnl, &header);
+
+  ok = ok && apply(files, log, &header, data);
+  files->close(log);
+
+  if (ok)
+  {
+    header.state = JOURNAL_COMMITTED;
+    write_header(files, jnl, &header);
+  }
+  files->close(jnl);
+
+  journal->retry_offset = ok ? -1 : (int32_t)header.offset;
+  return ok;
+}
@@ -0,0 +1,161 @@
+#include <string.h>
+
+#include <SD.h>
+
+#include "log_journal.h"
+#include "log_writer.h"
+#include "profile.h"
+#include "sd_retry.h"
+
+#define LOG_SEGMENTS 4 // log files with lines waiting, a new one each day
+
+static_assert(LOG_BUFFER_SIZE <= JOURNAL_MAX_DATA, "a flush must fit in one journal entry");
+
+// The lines for one log file, stored one after another in log_buffer
+struct Log_Segment
+{
+  char file_name[JOURNAL_NAME_SIZE];
+  size_t length;
+};
+
+static char log_buffer[LOG_BUFFER_SIZE];
+static size_t log_length = 0;
+static Log_Segment log_segments[LOG_SEGMENTS];
+static int num_segments = 0;
+static uint32_t lines_dropped = 0;
+static Journal journal;
+static Sd_Retry log_retry = {"the ADIF log"};
+
+// The journal and a log are the only files open at the same time
+static File sd_files[2];
+
+static void *sd_open(const char *name)
+{
+  for (File &file : sd_files)
+  {
+    if (!file)
+    {
+      file = SD.open(name, FILE_WRITE);
+      return file ? &file : NULL;
+    }
+  }
+  return NULL;
+}
+
+static void sd_close(void *file)
+{
+  ((File *)file)->close();
+  *(File *)file = File();
+}
+
+static uint32_t sd_size(void *file)
+{
+  return ((File *)file)->size();
+}
+
+static uint32_t sd_read(void *file, uint32_t offset, void *data, uint32_t len)
+{
+  File *f = (File *)file;
+  f->seek(offset);
+  int bytes_read = f->read(data, len);
+  return bytes_read > 0 ? bytes_read : 0;
+}
+
+static uint32_t sd_write(void *file, uint32_t offset, const void *data, uint32_t len)
+{
+  File *f = (File *)file;
+  f->seek(offset);
+  return f->write((const uint8_t *)data, len);
+}
+
+static void sd_truncate(void *file, uint32_t size)
+{
+  ((File *)file)->truncate(size);
+}
+
+static void sd_sync(void *file)
+{
+  ((File *)file)->flush();
+}
+
+static const Journal_Files sd_journal_files = {
+    sd_open, sd_close, sd_size, sd_read, sd_write, sd_truncate, sd_sync};
+
+void log_writer_begin(void)
+{
+  journal_init(&journal, &sd_journal_files, LOG_JOURNAL_FILE);
+
+  char file_name[JOURNAL_NAME_SIZE];
+  uint32_t replayed = journal_replay(&journal, log_buffer, file_name);
+  if (replayed > 0)
+    Serial.printf("Replayed %lu bytes of %s\n", (unsigned long)replayed, file_name);
+}
+
+// Never touches the card, the flush task writes the lines at a quiet moment
+void log_writer_append(const char *file_name, const char *line)
+{
+  size_t len = strlen(line);
+  if (len > LOG_BUFFER_SIZE - 2)
+    len = LOG_BUFFER_SIZE - 2;
+
+  Log_Segment *segment = (num_segments > 0) ? &log_segments[num_segments - 1] : NULL;
+  if (segment == NULL || strcmp(file_name, segment->file_name) != 0)
+    segment = (num_segments < LOG_SEGMENTS) ? &log_segments[num_segments] : NULL;
+
+  // The card has not been taking writes for a while, keep what is queued
+  if (segment == NULL || log_length + len + 2 > LOG_BUFFER_SIZE)
+  {
+    lines_dropped++;
+    return;
+  }
+
+  if (segment == &log_segments[num_segments])
+  {
+    strncpy(segment->file_name, file_name, sizeof(segment->file_name) - 1);
+    segment->file_name[sizeof(segment->file_name) - 1] = 0;
+    segment->length = 0;
+    num_segments++;
+  }
+
+  memcpy(log_buffer + log_length, line, len);
+  log_buffer[log_length + len] = '\r';
+  log_buffer[log_length + len + 1] = '\n';
+  log_length += len + 2;
+  segment->length += len + 2;
+}
+
+bool log_writer_pending(void)
+{
+  return num_segments > 0 && sd_retry_due(&log_retry);
+}
+
+// Writes the lines of the oldest log file, one journal entry per call
+void log_writer_flush(void)
+{
+  if (num_segments == 0)
+    return;
+
+  PROFILE_SCOPE(PROFILE_LOG_FLUSH);
+
+  // Lines that did not make it stay queued, the journal has kept the log
+  // as it was so they can be offered again
+  const Log_Segment *segment = &log_segments[0];
+  if (!journal_append(&journal, segment->file_name, log_buffer, segment->length))
+  {
+    sd_retry_failed(&log_retry);
+    return;
+  }
+  sd_retry_ok(&log_retry);
+
+  // Move the lines of the next log file to the front
+  log_length -= segment->length;
+  memmove(log_buffer, log_buffer + segment->length, log_length);
+  memmove(&log_segments[0], &log_segments[1], (num_segments - 1) * sizeof(Log_Segment));
+  num_segments--;
+
+  if (lines_dropped > 0)
+  {
+    Serial.printf("Log buffer was full, %lu lines dropped\n", (unsigned long)lines_dropped);
+    lines_dropped = 0;
+  }
+}
@@ -0,0 +1,86 @@
+#include "memory_map.h"
+
+// The stack grows down from the top of DTCM towards the end of .bss. Fill
+// that gap with a pattern at startup; the lowest word that no longer holds
+// the pattern is the deepest the stack (ISRs included) has ever reached.
+
+#if defined(__IMXRT1062__)
+
+#define STACK_PAINT 0xC5C5C5C5u
+#define STACK_MARGIN 256 // bytes left alone below the painting frame
+
+#define RAM2_START 0x20200000u
+
+// Symbols from the Teensy 4.1 linker script, only their addresses matter
+extern unsigned long _stext, _etext, _sdata, _ebss, _estack;
+extern unsigned long _heap_start, _heap_end;
+extern unsigned long _itcm_block_count;
+extern char *__brkval;
+#if defined(USE_PSRAM)
+extern unsigned long _extram_start, _extram_end;
+extern "C" uint8_t external_psram_size;
+#endif
+
+void memory_begin(void)
+{
+  uint32_t marker;
+  uint32_t *limit = (uint32_t *)((char *)&marker - STACK_MARGIN);
+
+  for (uint32_t *p = (uint32_t *)&_ebss; p < limit; p++)
+    *p = STACK_PAINT;
+}
+
+uint32_t memory_stack_high_water(void)
+{
+  const uint32_t *p = (const uint32_t *)&_ebss;
+  const uint32_t *top = (const uint32_t *)&_estack;
+
+  while (p < top && *p == STACK_PAINT)
+    p++;
+
+  return (uint32_t)((const char *)top - (const char *)p);
+}
+
+void memory_print(void)
+{
+  uint32_t itcm = (uint32_t)&_itcm_block_count * 32768;
+  uint32_t code = (uint32_t)&_etext - (uint32_t)&_stext;
+  uint32_t data = (uint32_t)&_ebss - (uint32_t)&_sdata;
+  uint32_t stack = (uint32_t)&_estack - (uint32_t)&_ebss;
+  uint32_t peak = memory_stack_high_water();
+
+  Serial.printf("RAM1: code %lu/%lu kB, data+bss %lu kB, stack peak %lu of %lu kB\n",
+                (unsigned long)(code / 1024), (unsigned long)(itcm / 1024),
+                (unsigned long)(data / 1024),
+                (unsigned long)(peak / 1024), (unsigned long)(stack / 1024));
+
+  uint32_t ram2 = (uint32_t)&_heap_start - RAM2_START;
+  uint32_t heap_free = (uint32_t)&_heap_end - (uint32_t)__brkval;
+
+  Serial.printf("RAM2: static %lu kB, heap free %lu kB\n",
+                (unsigned long)(ram2 / 1024), (unsigned long)(heap_free / 1024));
+
+#if defined(USE_PSRAM)
+  uint32_t extram = (uint32_t)&_extram_end - (uint32_t)&_extram_start;
+
+  Serial.printf("PSRAM: static %lu kB of %u MB\n",
+                (unsigned long)(extram / 1024), external_psram_size);
+#endif
+}
+
+#else
+
+void memory_begin(void)
+{
+}
+
+uint32_t memory_stack_high_water(void)
+{
+  return 0;
+}
+
+void memory_print(void)
+{
+}
+
+#endif
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "profile.h"
+
+// Per scope timing statistics in fixed RAM.
+// Percentiles come from a log scale histogram with four buckets per
+// power of two, so the p99 reported is good to within a quarter octave.
+
+#define PROFILE_BUCKETS 128
+
+struct Profile_Stats
+{
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t sum;
+  uint32_t histogram[PROFILE_BUCKETS];
+};
+
+static const char *const kProfile_names[NUM_PROFILE_SCOPES] = {
+    "process_data",
+    "extract_power",
+    "waterfall",
+    "find_sync",
+    "bp_decode",
+    "display_messages",
+    "draw_map",
+    "write_ADIF_Log",
+    "log_flush",
+};
+
+static Profile_Stats profile_stats[NUM_PROFILE_SCOPES];
+
+static int bucket_of(uint32_t ticks)
+{
+  if (ticks < 4)
+    return ticks;
+
+  int msb = 31 - __builtin_clz(ticks);
+  int sub = (ticks >> (msb - 2)) & 3;
+  return msb * 4 + sub - 4;
+}
+
+// Largest tick count that falls in a bucket
+static uint32_t bucket_limit(int bucket)
+{
+  if (bucket < 4)
+    return bucket;
+
+  int msb = bucket / 4 + 1;
+  int sub = bucket % 4;
+  return (uint32_t)((((uint64_t)(5 + sub)) << (msb - 2)) - 1);
+}
+
+void profile_record(int scope, uint32_t ticks)
+{
+  Profile_Stats *stats = &profile_stats[scope];
+
+  if (stats->count == 0 || ticks < stats->min)
+    stats->min = ticks;
+  if (ticks > stats->max)
+    stats->max = ticks;
+  stats->sum += ticks;
+  stats->count++;
+  stats->histogram[bucket_of(ticks)]++;
+}
+
+static uint32_t percentile(const Profile_Stats *stats, int percent)
+{
+  uint32_t target = (uint32_t)(((uint64_t)stats->count * percent + 99) / 100);
+  uint32_t seen = 0;
+
+  for (int bucket = 0; bucket < PROFILE_BUCKETS; bucket++)
+  {
+    seen += stats->histogram[bucket];
+    if (seen >= target)
+      return bucket_limit(bucket) < stats->max ? bucket_limit(bucket) : stats->max;
+  }
+  return stats->max;
+}
+
+// Ticks to microseconds
+static uint32_t to_us(uint64_t ticks)
+{
+#if defined(__IMXRT1062__)
+  return (uint32_t)(ticks / (F_CPU_ACTUAL / 1000000));
+#else
+  return (uint32_t)(ticks / 1000);
+#endif
+}
+
+void profile_print(void)
+{
+  char line[96];
+
+  snprintf(line, sizeof(line), "%-18s %8s %8s %8s %8s %8s\n", "scope", "count", "min us", "avg us", "p99 us", "max us");
+#if defined(__IMXRT1062__)
+  Serial.print(line);
+#else
+  fputs(line, stdout);
+#endif
+
+  for (int scope = 0; scope < NUM_PROFILE_SCOPES; scope++)
+  {
+    const Profile_Stats *stats = &profile_stats[scope];
+    if (stats->count == 0)
+      continue;
+
+    snprintf(line, sizeof(line), "%-18s %8lu %8lu %8lu %8lu %8lu\n",
+             kProfile_names[scope],
+             (unsigned long)stats->count,
+             (unsigned long)to_us(stats->min),
+             (unsigned long)to_us(stats->sum / stats->count),
+             (unsigned long)to_us(percentile(stats, 99)),
+             (unsigned long)to_us(stats->max));
+#if defined(__IMXRT1062__)
+    Serial.print(line);
+#else
+    fputs(line, stdout);
+#endif
+  }
+
+  memset(profile_stats, 0, sizeof(profile_stats));
+}
@@ -0,0 +1,29 @@
+#include <Arduino.h>
+
+#include "sd_retry.h"
+
+bool sd_retry_due(const Sd_Retry *retry)
+{
+  return retry->delay_ms == 0 || millis() - retry->failed_ms >= retry->delay_ms;
+}
+
+void sd_retry_failed(Sd_Retry *retry)
+{
+  if (retry->delay_ms == 0)
+  {
+    Serial.printf("Writing %s to the SD card failed, retrying\n", retry->what);
+    retry->delay_ms = SD_RETRY_FIRST_MS;
+  }
+  else if (retry->delay_ms < SD_RETRY_MAX_MS)
+  {
+    retry->delay_ms *= 2;
+  }
+  retry->failed_ms = millis();
+}
+
+void sd_retry_ok(Sd_Retry *retry)
+{
+  if (retry->delay_ms != 0)
+    Serial.printf("Writing %s to the SD card works again\n", retry->what);
+  retry->delay_ms = 0;
+}
@@ -0,0 +1,43 @@
+#include <string.h>
+
+#include "si5351_regs.h"
+
+void calc_ms_regs(uint64_t pll_freq, uint64_t freq, uint8_t regs[MS_REGS])
+{
+  uint32_t a = pll_freq / freq;
+  uint32_t b = (pll_freq % freq * MS_DENOM) / freq;
+  uint32_t c = b ? MS_DENOM : 1;
+
+  uint32_t p1 = 128 * a + ((128 * b) / c) - 512;
+  uint32_t p2 = 128 * b - c * ((128 * b) / c);
+  uint32_t p3 = c;
+
+  regs[0] = (p3 >> 8) & 0xFF;
+  regs[1] = p3 & 0xFF;
+  regs[2] = (p1 >> 16) & 0x03; // R_DIV 1, no divide by 4
+  regs[3] = (p1 >> 8) & 0xFF;
+  regs[4] = p1 & 0xFF;
+  regs[5] = ((p3 >> 12) & 0xF0) | ((p2 >> 16) & 0x0F);
+  regs[6] = (p2 >> 8) & 0xFF;
+  regs[7] = p2 & 0xFF;
+}
+
+int ms_load(Ms_Image *loaded, uint8_t base_addr, const uint8_t regs[MS_REGS], ms_write_t write)
+{
+  int first = 0, last = MS_REGS - 1;
+  if (loaded->valid)
+  {
+    while (first < MS_REGS && regs[first] == loaded->regs[first])
+      first++;
+    if (first == MS_REGS)
+      return 0;
+    while (regs[last] == loaded->regs[last])
+      last--;
+  }
+
+  int count = last - first + 1;
+  memcpy(loaded->regs + first, regs + first, count);
+  write(base_addr + first, count, loaded->regs + first);
+  loaded->valid = true;
+  return count;
+}
@@ -0,0 +1,51 @@
+#include <string.h>
+
+#include "symbol_clock.h"
+
+uint32_t symbol_clock_start(Symbol_Clock *clock, int steps, uint32_t slot_start_ms, uint32_t now_us)
+{
+  memset(clock, 0, sizeof(*clock));
+  clock->steps = steps;
+  uint32_t step_us = FT8_SYMBOL_US / steps;
+
+  // micros() and millis() count the same time base, so this stays exact
+  // across the 32 bit wrap of micros()
+  uint32_t elapsed_us = now_us - slot_start_ms * 1000u;
+  int next_step = elapsed_us / step_us + 1;
+  int first_step = TX_FIRST_BLOCK * steps;
+  if (next_step > first_step && (uint32_t)(next_step - first_step) * step_us > TX_MAX_LATE_US)
+  {
+    clock->step = TX_END_BLOCK * steps;
+    return 0;
+  }
+
+  // Late, the whole message goes out shifted to the next step boundary
+  uint32_t delay_us = next_step * step_us - elapsed_us;
+  clock->step = (next_step > first_step) ? first_step : next_step;
+  clock->expected_us = now_us + delay_us;
+  return delay_us;
+}
+
+int symbol_clock_tick(Symbol_Clock *clock, uint32_t now_us)
+{
+  TX_Clock_Stats *stats = &clock->stats;
+  int32_t error_us = (int32_t)(now_us - clock->expected_us);
+  clock->expected_us += FT8_SYMBOL_US / clock->steps;
+
+  if (stats->ticks == 0 || error_us < stats->min_error_us)
+    stats->min_error_us = error_us;
+  if (stats->ticks == 0 || error_us > stats->max_error_us)
+    stats->max_error_us = error_us;
+  stats->sum_error_us += error_us;
+  stats->ticks++;
+
+  int step = clock->step++ - TX_FIRST_BLOCK * clock->steps;
+  if (step < 0 || step >= TX_SYMBOLS * clock->steps)
+    return -1;
+  return step;
+}
+
+bool symbol_clock_done(const Symbol_Clock *clock)
+{
+  return clock->step >= TX_END_BLOCK * clock->steps;
+}
@@ -0,0 +1,146 @@
+#include <Arduino.h>
+
+#include "task_scheduler.h"
+
+// Cooperative scheduler for the work done from loop().
+// Each call runs one task to completion, so a real-time task waits at most
+// for the task already running, never for a queue of display work.
+
+static Task *task_table = NULL;
+static int task_count = 0;
+static uint32_t stats_since_ms;
+static uint64_t idle_polls;
+
+static void reset_stats(void)
+{
+  for (int i = 0; i < task_count; i++)
+    memset(&task_table[i].stats, 0, sizeof(Task_Stats));
+  stats_since_ms = millis();
+  idle_polls = 0;
+}
+
+void tasks_begin(Task *tasks, int num_tasks)
+{
+  task_table = tasks;
+  task_count = num_tasks;
+
+  uint32_t now = millis();
+  for (int i = 0; i < task_count; i++)
+  {
+    task_table[i].pending = false;
+    task_table[i].release_ms = now + task_table[i].period_ms;
+  }
+  reset_stats();
+}
+
+static bool task_ready(Task *task, uint32_t now)
+{
+  if (!task->ready)
+    return (int32_t)(now - task->release_ms) >= 0;
+
+  if (task->pending)
+    return true;
+
+  if (!task->ready())
+    return false;
+
+  task->pending = true;
+  task->release_ms = now;
+  return true;
+}
+
+static void run_task(Task *task, uint32_t now)
+{
+  Task_Stats *stats = &task->stats;
+
+  uint32_t latency_ms = now - task->release_ms;
+  if (latency_ms > stats->max_latency_ms)
+    stats->max_latency_ms = latency_ms;
+  if (latency_ms > task->deadline_ms)
+    stats->missed++;
+
+  uint32_t start_us = micros();
+  task->run();
+  uint32_t run_us = micros() - start_us;
+
+  stats->runs++;
+  stats->total_us += run_us;
+  if (run_us > stats->max_us)
+    stats->max_us = run_us;
+  if (run_us > task->budget_us)
+    stats->overruns++;
+
+  if (task->ready)
+    task->pending = false;
+  else
+  {
+    // A periodic task that fell behind skips the releases it missed
+    task->release_ms += task->period_ms;
+    uint32_t done = millis();
+    if ((int32_t)(done - task->release_ms) >= 0)
+      task->release_ms = done + task->period_ms;
+  }
+}
+
+void tasks_run_next(void)
+{
+  uint32_t now = millis();
+  Task *next = NULL;
+  uint32_t next_deadline = 0;
+
+  for (int i = 0; i < task_count; i++)
+  {
+    Task *task = &task_table[i];
+    if (!task_ready(task, now))
+      continue;
+
+    if (task->task_class == TASK_REALTIME)
+    {
+      next = task;
+      break;
+    }
+
+    uint32_t deadline = task->release_ms + task->deadline_ms;
+    if (!next || (int32_t)(deadline - next_deadline) < 0)
+    {
+      next = task;
+      next_deadline = deadline;
+    }
+  }
+
+  if (next)
+    run_task(next, now);
+  else
+    idle_polls++;
+}
+
+void tasks_print_stats(void)
+{
+  uint32_t elapsed_ms = millis() - stats_since_ms;
+  uint64_t busy_us = 0;
+
+  Serial.printf("%-10s %8s %8s %8s %6s %6s %6s %5s\n",
+                "task", "runs", "avg us", "max us", "over", "lat ms", "missed", "load");
+  for (int i = 0; i < task_count; i++)
+  {
+    const Task *task = &task_table[i];
+    const Task_Stats *stats = &task->stats;
+    busy_us += stats->total_us;
+
+    Serial.printf("%-10s %8lu %8lu %8lu %6lu %6lu %6lu %4lu%%\n",
+                  task->name,
+                  (unsigned long)stats->runs,
+                  (unsigned long)(stats->runs ? stats->total_us / stats->runs : 0),
+                  (unsigned long)stats->max_us,
+                  (unsigned long)stats->overruns,
+                  (unsigned long)stats->max_latency_ms,
+                  (unsigned long)stats->missed,
+                  (unsigned long)(elapsed_ms ? stats->total_us / 10 / elapsed_ms : 0));
+  }
+  Serial.printf("busy %lu%% of %lu ms, %lu idle polls\n",
+                (unsigned long)(elapsed_ms ? busy_us / 10 / elapsed_ms : 0),
+                (unsigned long)elapsed_ms,
+                (unsigned long)idle_polls);
+
+  reset_stats();
+}
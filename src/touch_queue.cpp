@@ -0,0 +1,120 @@
+#include <Arduino.h>
+#include <RA8876_t3.h>
+
+#include "touch_queue.h"
+#include "tx_scheduler.h"
+#include "trace.h"
+#include "main.h"
+
+// Touch events from the capacitive touch panel.
+// The controller interrupt only timestamps that a report is ready, the
+// report itself is read from loop() once per interrupt and turned into
+// press, drag and release events for the dispatcher in process_touch().
+
+#define SCREEN_WIDTH 1024
+#define SCREEN_HEIGHT 600
+
+static const int kTouch_events = 16;      // events queued before new ones are dropped
+static const uint32_t kRelease_ms = 100;  // no report for this long means the finger lifted
+static const int kDrag_pixels = 4;        // smaller moves are not reported as drags
+
+static volatile bool report_pending = false;
+static volatile uint32_t report_time_ms;
+
+static Touch_Event events[kTouch_events];
+static int event_head = 0;
+static int event_count = 0;
+
+static bool touch_down = false;
+static uint16_t last_x, last_y;
+static uint32_t last_report_ms;
+
+static void touch_isr(void)
+{
+  report_time_ms = millis();
+  report_pending = true;
+}
+
+static void queue_event(uint8_t type, uint16_t x, uint16_t y, uint32_t time_ms)
+{
+  if (event_count == kTouch_events)
+    return;
+
+  Touch_Event *event = &events[(event_head + event_count) % kTouch_events];
+  event->type = type;
+  event->x = x;
+  event->y = y;
+  event->time_ms = time_ms;
+  event_count++;
+}
+
+void touch_begin(int int_pin)
+{
+  attachInterrupt(digitalPinToInterrupt(int_pin), touch_isr, FALLING);
+}
+
+void touch_poll(void)
+{
+  if (!report_pending)
+  {
+    if (touch_down && millis() - last_report_ms > kRelease_ms)
+    {
+      queue_event(TOUCH_RELEASE, last_x, last_y, last_report_ms);
+      touch_down = false;
+    }
+    return;
+  }
+
+  noInterrupts();
+  uint32_t time_ms = report_time_ms;
+  report_pending = false;
+  interrupts();
+
+  // The touch controller shares the I2C bus with the Si5351
+  uint16_t coordinates[MAXTOUCHLIMIT][2];
+  uint8_t touches;
+  {
+    BUS_CLAIM();
+    TRACE_SCOPE(TRACE_I2C);
+    tft.updateTS();
+    tft.getTScoordinates(coordinates);
+    touches = tft.getTouches();
+  }
+
+  if (touches == 0)
+  {
+    if (touch_down)
+      queue_event(TOUCH_RELEASE, last_x, last_y, time_ms);
+    touch_down = false;
+    return;
+  }
+
+  uint16_t x = SCREEN_WIDTH - coordinates[0][0];
+  uint16_t y = SCREEN_HEIGHT - coordinates[0][1];
+
+  if (!touch_down)
+    queue_event(TOUCH_PRESS, x, y, time_ms);
+  else if (abs(x - last_x) >= kDrag_pixels || abs(y - last_y) >= kDrag_pixels)
+    queue_event(TOUCH_DRAG, x, y, time_ms);
+  else
+  {
+    last_report_ms = time_ms;
+    return;
+  }
+
+  touch_down = true;
+  last_x = x;
+  last_y = y;
+  last_report_ms = time_ms;
+}
+
+bool touch_get_event(Touch_Event *event)
+{
+  if (event_count == 0)
+    return false;
+
+  *event = events[event_head];
+  event_head = (event_head + 1) % kTouch_events;
+  event_count--;
+  return true;
+}
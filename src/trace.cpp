@@ -0,0 +1,110 @@
+#include <Arduino.h>
+
+#include "trace.h"
+#include "memory_map.h"
+
+// Timeline of the last few seconds of slot activity in a RAM ring buffer.
+// Recording is a timestamp and three small fields, so it can stay enabled
+// in the field; the JSON is only produced when the timeline is dumped.
+
+#define TRACE_ENTRIES 4096
+
+struct Trace_Entry
+{
+  uint32_t time_us;
+  uint8_t phase; // 'B', 'E' or 'i' as in trace_event
+  uint8_t event;
+  uint16_t arg;
+};
+
+struct Trace_Name
+{
+  const char *name;
+  uint8_t lane; // trace_event tid, one per kind of activity
+};
+
+static const Trace_Name kTrace_names[NUM_TRACE_EVENTS] = {
+    {"slot", 1},
+    {"fft", 2},
+    {"decode", 3},
+    {"ldpc", 3},
+    {"decoded", 3},
+    {"tx", 4},
+    {"tone", 4},
+    {"display", 5},
+    {"i2c", 6},
+};
+
+static const char *const kTrace_lanes[] = {"", "slot", "dsp", "decode", "tx", "display", "i2c"};
+
+static LARGE_RAM Trace_Entry trace_ring[TRACE_ENTRIES]; // only read below trace_next
+static volatile uint32_t trace_next = 0; // total entries ever written
+static volatile bool trace_paused = false;
+
+static void trace_record(uint8_t phase, int event, uint16_t arg)
+{
+  if (trace_paused)
+    return;
+
+  uint32_t time_us = micros();
+
+  // Claim the slot atomically, an interrupt may record in between
+  uint32_t slot = __atomic_fetch_add(&trace_next, 1, __ATOMIC_RELAXED);
+  Trace_Entry *entry = &trace_ring[slot % TRACE_ENTRIES];
+
+  entry->time_us = time_us;
+  entry->phase = phase;
+  entry->event = event;
+  entry->arg = arg;
+}
+
+void trace_begin(int event, uint16_t arg)
+{
+  trace_record('B', event, arg);
+}
+
+void trace_end(int event)
+{
+  trace_record('E', event, 0);
+}
+
+void trace_instant(int event, uint16_t arg)
+{
+  trace_record('i', event, arg);
+}
+
+void trace_dump(void)
+{
+  trace_paused = true;
+
+  uint32_t count = trace_next < TRACE_ENTRIES ? trace_next : TRACE_ENTRIES;
+  uint32_t first = trace_next - count;
+  uint32_t origin_us = count ? trace_ring[first % TRACE_ENTRIES].time_us : 0;
+
+  Serial.print("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  for (int lane = 1; lane < (int)(sizeof(kTrace_lanes) / sizeof(kTrace_lanes[0])); lane++)
+  {
+    Serial.printf("%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                  lane > 1 ? ",\n" : "", lane, kTrace_lanes[lane]);
+  }
+
+  for (uint32_t i = first; i < trace_next; i++)
+  {
+    const Trace_Entry *entry = &trace_ring[i % TRACE_ENTRIES];
+    const Trace_Name *name = &kTrace_names[entry->event];
+
+    // Relative to the oldest entry, which also unwraps micros()
+    Serial.printf(",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lu,\"pid\":1,\"tid\":%d",
+                  name->name, entry->phase,
+                  (unsigned long)(entry->time_us - origin_us), name->lane);
+    if (entry->phase == 'i')
+      Serial.print(",\"s\":\"t\"");
+    if (entry->phase != 'E')
+      Serial.printf(",\"args\":{\"arg\":%u}", entry->arg);
+    Serial.print("}");
+  }
+  Serial.print("\n]}\n");
+
+  trace_next = 0;
+  trace_paused = false;
+}
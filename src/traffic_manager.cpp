@@ -8,10 +8,37 @@
 #include "gen_ft8.h"
 #include "button.h"
 #include "main.h"
+#include "tx_scheduler.h"
+#include "si5351_regs.h"
+#include "trace.h"
 
 #define FT8_TONE_SPACING 625
+#define FT8_TONES 8
+#define FT8_LEVELS ((FT8_TONES - 1) * FT8_TONE_LEVELS + 1)
 
-static uint64_t F_Long, F_FT8, F_Receive;
+static uint64_t F_Long, F_Receive;
+
+// CLK0 multisynth images of every frequency level across the eight FT8 tones,
+// computed once per transmission, and the image currently loaded in the Si5351
+static uint8_t level_regs[FT8_LEVELS][MS_REGS];
+static Ms_Image clk0_image;
+
+static void write_clk0(uint8_t addr, uint8_t bytes, uint8_t *data)
+{
+  si5351.si5351_write_bulk(addr, bytes, data);
+}
+
+static void prepare_FT8_Tones(void)
+{
+  for (int level = 0; level < FT8_LEVELS; ++level)
+  {
+    uint64_t offset = ((uint64_t)level * FT8_TONE_SPACING + FT8_TONE_LEVELS / 2) / FT8_TONE_LEVELS;
+    calc_ms_regs(si5351.plla_freq, F_Long + offset, level_regs[level]);
+  }
+
+  // set_freq() has just loaded its own image, so the first tone is written in full
+  clk0_image.valid = false;
+}
 
 static void set_Xmit_Freq(void)
 {
@@ -21,6 +48,7 @@ static void set_Xmit_Freq(void)
 
 void tune_On_sequence(void)
 {
+  BUS_CLAIM();
   set_Xmit_Freq();
   transmit_sequence();
   sgtl5000.lineInLevel(0);
@@ -32,6 +60,7 @@ void tune_On_sequence(void)
 
 void tune_Off_sequence(void)
 {
+  BUS_CLAIM();
   si5351.output_enable(SI5351_CLK0, 0);
   delay(10);
   sgtl5000.lineInLevel(RX_volume);
@@ -39,14 +68,26 @@ void tune_Off_sequence(void)
   set_Attenuator_Gain(1.0);
 }
 
+// For loop() callers, the symbol interrupt calls set_FT8_Level() directly
 void set_FT8_Tone(uint8_t ft8_tone)
 {
-  F_FT8 = F_Long + (uint64_t)ft8_tone * FT8_TONE_SPACING;
-  si5351.set_freq(F_FT8, SI5351_CLK0);
+  BUS_CLAIM();
+  set_FT8_Level((ft8_tone & (FT8_TONES - 1)) * FT8_TONE_LEVELS);
+}
+
+void set_FT8_Level(uint8_t level)
+{
+  if (level >= FT8_LEVELS)
+    level = FT8_LEVELS - 1;
+
+  trace_begin(TRACE_TONE, level);
+  ms_load(&clk0_image, SI5351_CLK0_PARAMETERS, level_regs[level], write_clk0);
+  trace_end(TRACE_TONE);
 }
 
 void ft8_receive_sequence(void)
 {
+  BUS_CLAIM();
   si5351.output_enable(SI5351_CLK0, 0);
   sgtl5000.lineInLevel(RX_volume);
   set_RF_Gain(RF_Gain);
@@ -55,8 +96,10 @@ void ft8_receive_sequence(void)
 
 void ft8_transmit_sequence(void)
 {
+  BUS_CLAIM();
   set_Xmit_Freq();
   si5351.set_freq(F_Long, SI5351_CLK0);
+  prepare_FT8_Tones();
   sgtl5000.lineInLevel(0);
   set_RF_Gain(1);
   set_Attenuator_Gain(0.05);
@@ -66,7 +109,6 @@ void ft8_transmit_sequence(void)
 
 void setup_to_transmit_on_next_DSP_Flag(void)
 {
-  ft8_xmit_counter = 0;
   transmit_sequence();
   ft8_transmit_sequence();
   xmit_flag = 1;
@@ -74,6 +116,7 @@ void setup_to_transmit_on_next_DSP_Flag(void)
 
 void terminate_QSO(void)
 {
+  tx_scheduler_stop();
   ft8_receive_sequence();
   receive_sequence();
   xmit_flag = 0;
@@ -81,6 +124,7 @@ void terminate_QSO(void)
 
 void set_Rcvr_Freq(void)
 {
+  BUS_CLAIM();
   F_Receive = ((start_freq * 1000ULL - 10000ULL) * 100ULL * 4ULL);
   si5351.set_freq(F_Receive, SI5351_CLK1);
 }
@@ -0,0 +1,151 @@
+#include <Arduino.h>
+
+#include "tx_scheduler.h"
+#include "gfsk.h"
+#include "traffic_manager.h"
+#include "gen_ft8.h"
+#include "trace.h"
+
+// Symbol clock for FT8 transmissions.
+// A hardware timer fires on every 160 ms boundary counted from the slot
+// start and keys the next tone straight from the interrupt, so the symbol
+// timing no longer depends on how soon loop() gets round to the audio queue.
+// With GFSK shaping the timer runs GFSK_STEPS times faster and walks the
+// frequency through a precomputed trajectory between the tones.
+
+bool gfsk_shaping = false;
+
+static IntervalTimer symbol_timer;
+
+static Symbol_Clock tx_clock;
+static uint8_t shaped_levels[TX_SYMBOLS * GFSK_STEPS];
+static volatile bool tx_running;
+static volatile bool tx_finished;
+static volatile int bus_claims; // only changed from loop()
+static volatile int pending_level = -1;
+
+static void write_level(uint8_t level)
+{
+  uint32_t begin_us = micros();
+  set_FT8_Level(level);
+  uint32_t write_us = micros() - begin_us;
+  if (write_us > tx_clock.stats.max_write_us)
+    tx_clock.stats.max_write_us = write_us;
+}
+
+static void symbol_tick(void)
+{
+  int step = symbol_clock_tick(&tx_clock, micros());
+  if (step >= 0)
+  {
+    int level = tx_clock.steps > 1 ? shaped_levels[step] : tx_tones[step] * FT8_TONE_LEVELS;
+    if (bus_claims > 0)
+    {
+      pending_level = level;
+      tx_clock.stats.deferred++;
+    }
+    else
+      write_level(level);
+  }
+
+  if (symbol_clock_done(&tx_clock))
+  {
+    symbol_timer.end();
+    tx_running = false;
+    tx_finished = true;
+    trace_end(TRACE_TX);
+  }
+}
+
+void tx_scheduler_start(uint32_t slot_start_ms)
+{
+  tx_scheduler_stop();
+  tx_finished = false;
+
+  int steps = gfsk_shaping ? GFSK_STEPS : 1;
+  if (gfsk_shaping)
+    gfsk_levels(tx_tones, FT8_TONE_LEVELS, shaped_levels);
+
+  uint32_t delay_us = symbol_clock_start(&tx_clock, steps, slot_start_ms, micros());
+  if (delay_us == 0)
+  {
+    Serial.println("Too late to transmit in this slot");
+    tx_finished = true;
+    return;
+  }
+  tx_running = true;
+
+  // The first period runs to the next boundary, the timer reloads with a
+  // whole step from then on
+  trace_begin(TRACE_TX, tx_clock.step / steps);
+  symbol_timer.begin(symbol_tick, delay_us);
+  symbol_timer.update(FT8_SYMBOL_US / steps);
+}
+
+void tx_scheduler_stop(void)
+{
+  symbol_timer.end();
+  if (tx_running)
+    trace_end(TRACE_TX);
+  tx_running = false;
+  pending_level = -1;
+}
+
+bool tx_scheduler_finished(void)
+{
+  if (!tx_finished)
+    return false;
+
+  tx_finished = false;
+  return true;
+}
+
+void tx_scheduler_claim_bus(void)
+{
+  bus_claims = bus_claims + 1;
+}
+
+void tx_scheduler_release_bus(void)
+{
+  if (bus_claims > 1)
+  {
+    bus_claims = bus_claims - 1;
+    return;
+  }
+
+  // The bus stays claimed while a deferred step is written, so the
+  // interrupt can only defer again rather than write over it
+  for (;;)
+  {
+    noInterrupts();
+    int level = pending_level;
+    pending_level = -1;
+    if (level < 0)
+      bus_claims = 0;
+    interrupts();
+
+    if (level < 0)
+      return;
+    if (tx_running)
+      write_level(level);
+  }
+}
+
+void tx_scheduler_print_stats(void)
+{
+  noInterrupts();
+  TX_Clock_Stats snapshot = tx_clock.stats;
+  interrupts();
+
+  Serial.printf("TX symbol clock: %lu ticks", (unsigned long)snapshot.ticks);
+  if (snapshot.ticks)
+  {
+    Serial.printf(", error min %ld avg %ld max %ld us",
+                  (long)snapshot.min_error_us,
+                  (long)(snapshot.sum_error_us / (int64_t)snapshot.ticks),
+                  (long)snapshot.max_error_us);
+  }
+  Serial.printf(", write max %lu us, %lu deferred\n",
+                (unsigned long)snapshot.max_write_us,
+                (unsigned long)snapshot.deferred);
+}
@@ -0,0 +1,184 @@
+#include <string.h>
+#include <ctype.h>
+
+#include <SD.h>
+#include <TimeLib.h>
+
+#include "worked_before.h"
+#include "button.h"
+#include "memory_map.h"
+
+// Open addressing on a 32-bit FNV-1a fingerprint of the callsign. Two calls
+// sharing a fingerprint would only make one of them look worked, at a few
+// thousand entries the odds of that are about one in a million.
+#define WORKED_SLOTS 8192                         // power of two
+#define WORKED_MAX_ENTRIES (WORKED_SLOTS / 4 * 3) // keep probe chains short
+#define WORKED_REBUILD_FILE "WORKED.TMP"
+#define WORKED_MODES 8 // bits of Worked_Slot::modes
+
+struct Worked_Slot
+{
+  uint32_t key; // 0 marks a free slot
+  uint8_t bands;
+  uint8_t modes;
+  uint16_t last_day;
+};
+
+static LARGE_RAM Worked_Slot worked_slots[WORKED_SLOTS]; // cleared in worked_before_begin()
+static int worked_count = 0;
+static File rebuild_file; // open while the index is rebuilt from the logs
+
+// Copy of call without surrounding blanks, upper case and NUL padded
+static void normalize_call(const char *call, char out[WORKED_CALL_SIZE])
+{
+  memset(out, 0, WORKED_CALL_SIZE);
+
+  while (*call == ' ')
+    call++;
+
+  for (int i = 0; i < WORKED_CALL_SIZE - 1 && call[i] != 0 && call[i] != ' '; i++)
+    out[i] = toupper(call[i]);
+}
+
+static uint32_t call_key(const char call[WORKED_CALL_SIZE])
+{
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < WORKED_CALL_SIZE && call[i] != 0; i++)
+  {
+    hash ^= (uint8_t)call[i];
+    hash *= 16777619u;
+  }
+  return hash ? hash : 1;
+}
+
+static Worked_Slot *find_slot(uint32_t key)
+{
+  uint32_t index = key & (WORKED_SLOTS - 1);
+  while (worked_slots[index].key != 0 && worked_slots[index].key != key)
+    index = (index + 1) & (WORKED_SLOTS - 1);
+  return &worked_slots[index];
+}
+
+// Records read back from the card are checked here, a corrupt band or mode
+// would shift past the bit masks
+static void remember(const Worked_Record *record)
+{
+  if (record->band > NumBands || record->mode >= WORKED_MODES)
+    return;
+
+  uint32_t key = call_key(record->call);
+  Worked_Slot *slot = find_slot(key);
+
+  if (slot->key == 0)
+  {
+    if (worked_count >= WORKED_MAX_ENTRIES)
+    {
+      static bool warned = false;
+      if (!warned)
+        Serial.println("Worked before index full");
+      warned = true;
+      return;
+    }
+
+    slot->key = key;
+    slot->bands = slot->modes = 0;
+    slot->last_day = 0;
+    worked_count++;
+  }
+
+  slot->bands |= 1 << record->band;
+  slot->modes |= 1 << record->mode;
+  if (record->day > slot->last_day)
+    slot->last_day = record->day;
+}
+
+static void load_index(File &index)
+{
+  Worked_Record records[32];
+  int bytes_read;
+
+  while ((bytes_read = index.read(records, sizeof(records))) >= (int)sizeof(Worked_Record))
+  {
+    for (int i = 0; i < bytes_read / (int)sizeof(Worked_Record); i++)
+    {
+      remember(&records[i]);
+    }
+  }
+}
+
+bool worked_before_begin(void)
+{
+  memset(worked_slots, 0, sizeof(worked_slots));
+  worked_count = 0;
+
+  File index = SD.open(WORKED_INDEX_FILE, FILE_READ);
+  if (index)
+  {
+    load_index(index);
+    index.close();
+    return true;
+  }
+
+  // Rebuild under another name so that a power cycle part way through
+  // starts again, and create it now so it is not a new directory entry
+  // while the logs are being walked
+  SD.remove(WORKED_REBUILD_FILE);
+  rebuild_file = SD.open(WORKED_REBUILD_FILE, FILE_WRITE);
+  return false;
+}
+
+static void save(const Worked_Record *record)
+{
+  if (rebuild_file)
+  {
+    rebuild_file.write((const uint8_t *)record, sizeof(*record));
+    return;
+  }
+
+  File index = SD.open(WORKED_INDEX_FILE, FILE_WRITE);
+  if (index)
+  {
+    index.write((const uint8_t *)record, sizeof(*record));
+    index.close();
+  }
+}
+
+void worked_before_import(const char *call, int band, uint16_t day)
+{
+  Worked_Record record;
+  normalize_call(call, record.call);
+  if (record.call[0] == 0)
+    return;
+
+  record.band = band;
+  record.mode = WORKED_MODE_FT8;
+  record.day = day;
+  remember(&record);
+  save(&record);
+}
+
+void worked_before_import_done(void)
+{
+  if (!rebuild_file)
+    return;
+
+  rebuild_file.close();
+  rebuild_file = File();
+  SD.rename(WORKED_REBUILD_FILE, WORKED_INDEX_FILE);
+}
+
+bool worked_before(const char *call, int band)
+{
+  char normalized[WORKED_CALL_SIZE];
+  normalize_call(call, normalized);
+  if (normalized[0] == 0)
+    return false;
+
+  const Worked_Slot *slot = find_slot(call_key(normalized));
+  return slot->key != 0 && (slot->bands & (1 << band)) != 0;
+}
+
+void worked_before_add(const char *call, int band)
+{
+  worked_before_import(call, band, (uint16_t)elapsedDays(now()));
+}
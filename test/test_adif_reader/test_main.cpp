@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "adif_reader.h"
+
+// The sample logs in fixtures/ fed to the reader in pieces of every size
+// from a byte upwards, the handler has to see the same records each time.
+// wsjtx.adi has a header with a call in it, typed fields and a field whose
+// value holds '<' and ':', logger.adi CRLF lines, upper and mixed case tags,
+// a record spread over several lines and a last record cut off mid value.
+
+static const int kMax_records = 8;
+static const size_t kMax_fixture = 4096;
+
+static Adif_Record records[kMax_records];
+static int num_records;
+
+static void store_record(const Adif_Record *record, void *user)
+{
+  (void)user;
+  if (num_records < kMax_records)
+    records[num_records] = *record;
+  num_records++;
+}
+
+// The fixtures live next to this file
+static size_t read_fixture(const char *name, char *data)
+{
+  char path[512];
+  const char *slash = strrchr(__FILE__, '/');
+  int dir_len = slash ? (int)(slash - __FILE__) + 1 : 0;
+  snprintf(path, sizeof(path), "%.*sfixtures/%s", dir_len, __FILE__, name);
+
+  FILE *file = fopen(path, "rb");
+  TEST_ASSERT_NOT_NULL_MESSAGE(file, path);
+  size_t len = fread(data, 1, kMax_fixture, file);
+  fclose(file);
+  TEST_ASSERT_TRUE(len > 0 && len < kMax_fixture);
+  return len;
+}
+
+static void feed_in_chunks(const char *data, size_t len, size_t chunk)
+{
+  Adif_Reader reader;
+  adif_reader_init(&reader, store_record, NULL);
+  num_records = 0;
+
+  for (size_t pos = 0; pos < len; pos += chunk)
+    adif_reader_feed(&reader, data + pos, (len - pos < chunk) ? len - pos : chunk);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_header_and_typed_fields(void)
+{
+  static char data[kMax_fixture];
+  size_t len = read_fixture("wsjtx.adi", data);
+
+  for (size_t chunk = 1; chunk <= len; chunk += (chunk < 16) ? 1 : 37)
+  {
+    feed_in_chunks(data, len, chunk);
+
+    // The <call:6>HEADER before <eoh> is not a record
+    TEST_ASSERT_EQUAL_INT(2, num_records);
+
+    TEST_ASSERT_EQUAL_STRING("G8KIG", records[0].call);
+    TEST_ASSERT_EQUAL_STRING("IO91", records[0].gridsquare);
+    TEST_ASSERT_EQUAL_STRING("14.075500", records[0].freq);
+    TEST_ASSERT_EQUAL_STRING("20m", records[0].band);
+    TEST_ASSERT_EQUAL_STRING("20260112", records[0].qso_date);
+    TEST_ASSERT_EQUAL_STRING("101530", records[0].time_on);
+    TEST_ASSERT_EQUAL_STRING("-09", records[0].rst_sent);
+    TEST_ASSERT_EQUAL_STRING("+02", records[0].rst_rcvd);
+
+    // The comment holds "<b>" and "c:1", only its length ends it
+    TEST_ASSERT_EQUAL_STRING("K1JT", records[1].call);
+    TEST_ASSERT_EQUAL_STRING("FN20", records[1].gridsquare);
+    TEST_ASSERT_EQUAL_STRING("20260112", records[1].qso_date);
+    TEST_ASSERT_EQUAL_STRING("102045", records[1].time_on);
+    TEST_ASSERT_EQUAL_STRING("7.075200", records[1].freq);
+    TEST_ASSERT_EQUAL_STRING("40m", records[1].band);
+    TEST_ASSERT_EQUAL_STRING("-15", records[1].rst_sent);
+    TEST_ASSERT_EQUAL_STRING("-11", records[1].rst_rcvd);
+  }
+}
+
+void test_upper_case_multi_line_and_truncated(void)
+{
+  static char data[kMax_fixture];
+  size_t len = read_fixture("logger.adi", data);
+
+  for (size_t chunk = 1; chunk <= len; chunk += (chunk < 16) ? 1 : 37)
+  {
+    feed_in_chunks(data, len, chunk);
+
+    // The last record has no <eor>, it never reaches the handler
+    TEST_ASSERT_EQUAL_INT(2, num_records);
+
+    TEST_ASSERT_EQUAL_STRING("DL1ABC", records[0].call);
+    TEST_ASSERT_EQUAL_STRING("JO62qm", records[0].gridsquare);
+    TEST_ASSERT_EQUAL_STRING("20251231", records[0].qso_date);
+    TEST_ASSERT_EQUAL_STRING("2359", records[0].time_on);
+    TEST_ASSERT_EQUAL_STRING("21.075000", records[0].freq);
+    TEST_ASSERT_EQUAL_STRING("15M", records[0].band);
+    TEST_ASSERT_EQUAL_STRING("-20", records[0].rst_sent);
+    TEST_ASSERT_EQUAL_STRING("-5", records[0].rst_rcvd);
+
+    // Fields the record does not have are left empty
+    TEST_ASSERT_EQUAL_STRING("VK2XY", records[1].call);
+    TEST_ASSERT_EQUAL_STRING("10m", records[1].band);
+    TEST_ASSERT_EQUAL_STRING("20260101", records[1].qso_date);
+    TEST_ASSERT_EQUAL_STRING("", records[1].gridsquare);
+    TEST_ASSERT_EQUAL_STRING("", records[1].rst_sent);
+  }
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_header_and_typed_fields);
+  RUN_TEST(test_upper_case_multi_line_and_truncated);
+  return UNITY_END();
+}
@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unity.h>
+
+#include "constants.h"
+#include "encode.h"
+
+// The table CRC-14 and the word-wise encode174() against the bit-serial
+// versions they replaced, on random payloads and bit lengths
+
+static const int kRandom_payloads = 20000;
+static const int kMessage_bytes = 12; // K_BYTES, 91 bits
+
+// Returns 1 if an odd number of bits are set in x, zero otherwise
+static uint8_t parity8(uint8_t x)
+{
+  x ^= x >> 4;
+  x ^= x >> 2;
+  x ^= x >> 1;
+  return x & 1;
+}
+
+static void reference_encode174(const uint8_t *message, uint8_t *codeword)
+{
+  for (int j = 0; j < (7 + N) / 8; ++j)
+    codeword[j] = (j < K_BYTES) ? message[j] : 0;
+
+  uint8_t col_mask = (0x80 >> (K % 8));
+  uint8_t col_idx = K_BYTES - 1;
+
+  for (int i = 0; i < M; ++i)
+  {
+    uint8_t nsum = 0;
+    for (int j = 0; j < K_BYTES; ++j)
+      nsum ^= parity8(message[j] & kGenerator[i][j]);
+    if (nsum % 2)
+      codeword[col_idx] |= col_mask;
+
+    col_mask >>= 1;
+    if (col_mask == 0)
+    {
+      col_mask = 0x80;
+      ++col_idx;
+    }
+  }
+}
+
+static uint16_t reference_crc(uint8_t *message, int num_bits)
+{
+  const uint16_t TOPBIT = (1 << (CRC_WIDTH - 1));
+  uint16_t remainder = 0;
+  int idx_byte = 0;
+
+  for (int idx_bit = 0; idx_bit < num_bits; ++idx_bit)
+  {
+    if (idx_bit % 8 == 0)
+      remainder ^= (message[idx_byte++] << (CRC_WIDTH - 8));
+
+    if (remainder & TOPBIT)
+      remainder = (remainder << 1) ^ CRC_POLYNOMIAL;
+    else
+      remainder = (remainder << 1);
+  }
+  return remainder & ((1 << CRC_WIDTH) - 1);
+}
+
+static void random_bytes(uint8_t *bytes, int num_bytes)
+{
+  for (int i = 0; i < num_bytes; ++i)
+    bytes[i] = rand();
+}
+
+static double elapsed_ns(const struct timespec *start)
+{
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+void setUp(void) { srand(2); }
+void tearDown(void) {}
+
+void test_crc_matches_bit_serial(void)
+{
+  for (int n = 0; n < kRandom_payloads; ++n)
+  {
+    // Bits past num_bits in the last byte are left random on purpose
+    uint8_t message[16];
+    random_bytes(message, sizeof(message));
+    int num_bits = rand() % (8 * (int)sizeof(message) + 1);
+    TEST_ASSERT_EQUAL_UINT16(reference_crc(message, num_bits), crc(message, num_bits));
+  }
+}
+
+// The length genft8() and the decoder use, with the CRC bits cleared
+void test_crc_of_ft8_payloads(void)
+{
+  for (int n = 0; n < kRandom_payloads; ++n)
+  {
+    uint8_t a91[12];
+    random_bytes(a91, 10);
+    a91[9] &= 0xF8;
+    a91[10] = a91[11] = 0;
+    TEST_ASSERT_EQUAL_UINT16(reference_crc(a91, 96 - 14), crc(a91, 96 - 14));
+  }
+}
+
+void test_encode174_matches_bit_serial(void)
+{
+  for (int n = 0; n < kRandom_payloads; ++n)
+  {
+    uint8_t message[kMessage_bytes];
+    random_bytes(message, kMessage_bytes);
+    message[kMessage_bytes - 1] &= 0xE0; // 91 bits
+
+    uint8_t expected[22], codeword[22];
+    reference_encode174(message, expected);
+    encode174(message, codeword);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, codeword, sizeof(codeword));
+  }
+}
+
+void test_benchmark(void)
+{
+  static uint8_t messages[kRandom_payloads][kMessage_bytes];
+  for (int n = 0; n < kRandom_payloads; ++n)
+  {
+    random_bytes(messages[n], kMessage_bytes);
+    messages[n][kMessage_bytes - 1] &= 0xE0;
+  }
+
+  struct timespec start;
+  volatile unsigned sink = 0;
+  uint8_t codeword[22];
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int n = 0; n < kRandom_payloads; ++n)
+    sink += reference_crc(messages[n], 82);
+  double reference_crc_ns = elapsed_ns(&start) / kRandom_payloads;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int n = 0; n < kRandom_payloads; ++n)
+    sink += crc(messages[n], 82);
+  double crc_ns = elapsed_ns(&start) / kRandom_payloads;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int n = 0; n < kRandom_payloads; ++n)
+  {
+    reference_encode174(messages[n], codeword);
+    sink += codeword[21];
+  }
+  double reference_encode_ns = elapsed_ns(&start) / kRandom_payloads;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int n = 0; n < kRandom_payloads; ++n)
+  {
+    encode174(messages[n], codeword);
+    sink += codeword[21];
+  }
+  double encode_ns = elapsed_ns(&start) / kRandom_payloads;
+
+  char message[128];
+  snprintf(message, sizeof(message), "crc: bit-serial %.0f ns, table %.0f ns; encode174: bytes %.0f ns, words %.0f ns",
+           reference_crc_ns, crc_ns, reference_encode_ns, encode_ns);
+  TEST_MESSAGE(message);
+  (void)sink;
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_crc_matches_bit_serial);
+  RUN_TEST(test_crc_of_ft8_payloads);
+  RUN_TEST(test_encode174_matches_bit_serial);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,199 @@
+#include <complex>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unity.h>
+
+#include "gfsk.h"
+
+// Occupied bandwidth of a shaped transmission against hard keyed tones.
+// Both are synthesised the way the Si5351 produces them, a phase continuous
+// carrier stepped in frequency every 5 ms, and compared on the spectrum of
+// the whole 12.64 s transmission.
+
+typedef std::complex<double> cplx;
+
+static const int kLevels_per_tone = 16; // FT8_TONE_LEVELS
+static const double kTone_spacing = 6.25;
+static const double kSample_rate = 1600.0;
+static const int kFFT_size = 32768;
+static const int kSteps = TX_SYMBOLS * GFSK_STEPS;
+static const double kStep_seconds = 0.16 / GFSK_STEPS;
+
+static const uint8_t kCostas[7] = {3, 1, 4, 0, 6, 5, 2};
+
+static cplx signal[kFFT_size];
+
+static void random_tones(uint8_t tones[TX_SYMBOLS])
+{
+  for (int k = 0; k < TX_SYMBOLS; ++k)
+    tones[k] = rand() % 8;
+  for (int i = 0; i < 7; ++i)
+    tones[i] = tones[36 + i] = tones[72 + i] = kCostas[i];
+}
+
+static void fft(cplx *x, int n)
+{
+  for (int i = 1, j = 0; i < n; ++i)
+  {
+    int bit = n >> 1;
+    for (; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+    if (i < j)
+      std::swap(x[i], x[j]);
+  }
+  for (int len = 2; len <= n; len <<= 1)
+  {
+    cplx w_len = std::polar(1.0, -2 * M_PI / len);
+    for (int i = 0; i < n; i += len)
+    {
+      cplx w = 1;
+      for (int k = 0; k < len / 2; ++k)
+      {
+        cplx u = x[i + k], v = x[i + k + len / 2] * w;
+        x[i + k] = u + v;
+        x[i + k + len / 2] = u - v;
+        w *= w_len;
+      }
+    }
+  }
+}
+
+// Complex baseband of the stepped carrier, centred on the middle of the
+// eight tones, windowed and zero padded to the FFT size
+static void synthesise(const uint8_t levels[kSteps])
+{
+  const double centre = 3.5 * kTone_spacing;
+  const int samples_per_step = (int)lround(kStep_seconds * kSample_rate);
+  double phase = 0;
+  int n = 0;
+
+  const int length = kSteps * samples_per_step;
+
+  for (int step = 0; step < kSteps; ++step)
+  {
+    double freq = levels[step] * kTone_spacing / kLevels_per_tone - centre;
+    for (int i = 0; i < samples_per_step; ++i)
+    {
+      // A Blackman window keeps the sidelobes of switching the carrier on
+      // and off below those of the modulation
+      double a = 2 * M_PI * n / (length - 1);
+      double window = 0.42 - 0.5 * cos(a) + 0.08 * cos(2 * a);
+      signal[n++] = std::polar(window, phase);
+      phase += 2 * M_PI * freq / kSample_rate;
+    }
+  }
+  while (n < kFFT_size)
+    signal[n++] = 0;
+}
+
+// Width in Hz that holds 99% of the power, 0.5% left out at either side,
+// and the fraction of the power further than edge_hz from the centre
+static double occupied_bandwidth(const uint8_t levels[kSteps], double edge_hz, double *outside)
+{
+  synthesise(levels);
+  fft(signal, kFFT_size);
+
+  static double power[kFFT_size];
+  double total = 0;
+  for (int i = 0; i < kFFT_size; ++i)
+  {
+    // Reorder so that index 0 is the most negative frequency
+    int bin = (i + kFFT_size / 2) % kFFT_size;
+    power[i] = std::norm(signal[bin]);
+    total += power[i];
+  }
+
+  const double bin_hz = kSample_rate / kFFT_size;
+  double sum = 0, beyond = 0;
+  int low = -1, high = -1;
+  for (int i = 0; i < kFFT_size; ++i)
+  {
+    sum += power[i];
+    if (low < 0 && sum >= 0.005 * total)
+      low = i;
+    if (high < 0 && sum >= 0.995 * total)
+      high = i;
+    if (fabs((i - kFFT_size / 2) * bin_hz) > edge_hz)
+      beyond += power[i];
+  }
+
+  *outside = beyond / total;
+  return (high - low) * bin_hz;
+}
+
+void setUp(void) { srand(5); }
+void tearDown(void) {}
+
+void test_trajectory_passes_through_the_tones(void)
+{
+  uint8_t tones[TX_SYMBOLS];
+  uint8_t levels[kSteps];
+  random_tones(tones);
+  gfsk_levels(tones, kLevels_per_tone, levels);
+
+  for (int k = 0; k < TX_SYMBOLS; ++k)
+  {
+    // Mid symbol the pulse of the symbol itself dominates
+    int mid = levels[k * GFSK_STEPS + GFSK_STEPS / 2];
+    TEST_ASSERT_LESS_OR_EQUAL(1, abs(mid - tones[k] * kLevels_per_tone));
+    for (int j = 0; j < GFSK_STEPS; ++j)
+      TEST_ASSERT_LESS_OR_EQUAL(7 * kLevels_per_tone, levels[k * GFSK_STEPS + j]);
+  }
+
+  // The ends are held on the first and last tones
+  TEST_ASSERT_EQUAL_INT(tones[0] * kLevels_per_tone, levels[0]);
+  TEST_ASSERT_EQUAL_INT(tones[TX_SYMBOLS - 1] * kLevels_per_tone, levels[kSteps - 1]);
+}
+
+void test_occupied_bandwidth(void)
+{
+  const double edge_hz = 50.0; // just outside the 43.75 Hz the tones span
+  double hard_sum = 0, shaped_sum = 0;
+  double hard_outside = 0, shaped_outside = 0;
+  const int messages = 8;
+
+  for (int m = 0; m < messages; ++m)
+  {
+    uint8_t tones[TX_SYMBOLS];
+    uint8_t hard[kSteps], shaped[kSteps];
+    random_tones(tones);
+    for (int step = 0; step < kSteps; ++step)
+      hard[step] = tones[step / GFSK_STEPS] * kLevels_per_tone;
+    gfsk_levels(tones, kLevels_per_tone, shaped);
+
+    double outside;
+    double hard_obw = occupied_bandwidth(hard, edge_hz, &outside);
+    hard_outside += outside;
+    double shaped_obw = occupied_bandwidth(shaped, edge_hz, &outside);
+    shaped_outside += outside;
+
+    TEST_ASSERT_LESS_THAN(hard_obw, shaped_obw);
+    hard_sum += hard_obw;
+    shaped_sum += shaped_obw;
+  }
+
+  hard_outside /= messages;
+  shaped_outside /= messages;
+
+  char message[160];
+  snprintf(message, sizeof(message), "99%% bandwidth: hard %.1f Hz, GFSK %.1f Hz; power beyond +-%.0f Hz: hard %.1f dB, GFSK %.1f dB",
+           hard_sum / messages, shaped_sum / messages, edge_hz,
+           10 * log10(hard_outside), 10 * log10(shaped_outside));
+  TEST_MESSAGE(message);
+
+  // FT8 is nominally 50 Hz wide
+  TEST_ASSERT_LESS_THAN(50.0, shaped_sum / messages);
+
+  // Key clicks beyond that are over 15 dB down on hard keying
+  TEST_ASSERT_LESS_THAN(hard_outside / 30, shaped_outside);
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_trajectory_passes_through_the_tones);
+  RUN_TEST(test_occupied_bandwidth);
+  return UNITY_END();
+}
@@ -0,0 +1,198 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <unity.h>
+
+#include "constants.h"
+#include "encode.h"
+#include "ldpc.h"
+
+// ldpc_decode() and bp_decode() on noisy codewords, run on a thread with a
+// small fixed stack over a guard page, so that a decoder going back to a
+// large stack frame crashes the test. The stack is painted first to report
+// how much was used. bp_decode_batch() only exists on hosts with float SIMD
+// and is checked against bp_decode() on the main thread.
+
+static const size_t kStack_size = 16 * 1024;
+static const uint8_t kStack_paint = 0xA5;
+static const int kCodewords = 200;
+static const int kIterations = 20;
+static const int kMessage_bytes = 12;
+
+struct Decode_Results
+{
+  int ref_ok;       // codewords ldpc_decode() corrected
+  int bp_ok;        // codewords bp_decode() corrected
+  int both_ok;      // codewords both corrected
+  int disagree;     // corrected by both with different bits
+  int batch_differ; // bp_decode_batch() results that differ from bp_decode()
+};
+
+static Decode_Results results;
+static float log174[kCodewords][174];
+static Bits174 single[kCodewords];
+static int single_errors[kCodewords];
+
+static float gaussian(void)
+{
+  float u1 = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+  float u2 = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+  return sqrtf(-2.0f * logf(u1)) * cosf(2.0f * (float)M_PI * u2);
+}
+
+// Log likelihoods of a random message sent over a noisy channel, positive for a 1,
+// normalised to a variance of 16 like extract_likelihood() does
+static void noisy_codeword(float sigma, float log174[174])
+{
+  uint8_t message[kMessage_bytes];
+  for (int i = 0; i < kMessage_bytes; ++i)
+    message[i] = rand();
+  message[kMessage_bytes - 1] &= 0xE0; // 91 bits
+
+  uint8_t codeword[22];
+  encode174(message, codeword);
+
+  for (int i = 0; i < N; ++i)
+  {
+    float bit = ((codeword[i / 8] >> (7 - i % 8)) & 1) ? 1.0f : -1.0f;
+    log174[i] = bit + sigma * gaussian();
+  }
+
+  float sum = 0, sum2 = 0;
+  for (int i = 0; i < N; ++i)
+  {
+    sum += log174[i];
+    sum2 += log174[i] * log174[i];
+  }
+  float variance = (sum2 - sum * sum / N) / N;
+  float norm_factor = sqrtf(16.0f / variance);
+  for (int i = 0; i < N; ++i)
+    log174[i] *= norm_factor;
+}
+
+static bool same_bits(const uint8_t ref[], const Bits174 *packed)
+{
+  for (int i = 0; i < N; ++i)
+  {
+    if (ref[i] != ((packed->word[i / 64] >> (63 - i % 64)) & 1))
+      return false;
+  }
+  return true;
+}
+
+static void *decode_thread(void *arg)
+{
+  (void)arg;
+
+  for (int c = 0; c < kCodewords; ++c)
+  {
+    // Both decoders work on their own copy, ldpc_decode() takes a non-const pointer
+    float copy[174];
+    memcpy(copy, log174[c], sizeof(copy));
+
+    uint8_t ref_plain[174];
+    int ref_errors;
+    ldpc_decode(copy, kIterations, ref_plain, &ref_errors);
+
+    memcpy(copy, log174[c], sizeof(copy));
+    bp_decode(copy, kIterations, &single[c], &single_errors[c]);
+
+    if (ref_errors == 0)
+      ++results.ref_ok;
+    if (single_errors[c] == 0)
+      ++results.bp_ok;
+    if (ref_errors == 0 && single_errors[c] == 0)
+    {
+      ++results.both_ok;
+      if (!same_bits(ref_plain, &single[c]))
+        ++results.disagree;
+    }
+  }
+  return NULL;
+}
+
+#if LDPC_LANES > 1
+static void compare_batch(void)
+{
+  for (int c = 0; c + LDPC_LANES <= kCodewords; c += LDPC_LANES)
+  {
+    Bits174 batch[LDPC_LANES];
+    int batch_errors[LDPC_LANES];
+    bp_decode_batch(&log174[c], LDPC_LANES, kIterations, batch, batch_errors);
+
+    for (int lane = 0; lane < LDPC_LANES; ++lane)
+    {
+      if (batch_errors[lane] != single_errors[c + lane] ||
+          (batch_errors[lane] == 0 && memcmp(&batch[lane], &single[c + lane], sizeof(Bits174)) != 0))
+        ++results.batch_differ;
+    }
+  }
+}
+#endif
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_decoders_agree_on_a_small_stack(void)
+{
+  srand(43);
+  for (int c = 0; c < kCodewords; ++c)
+    noisy_codeword(0.8f, log174[c]);
+
+  size_t page = sysconf(_SC_PAGESIZE);
+  uint8_t *mapping = (uint8_t *)mmap(NULL, page + kStack_size, PROT_READ | PROT_WRITE,
+                                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  TEST_ASSERT_TRUE(mapping != MAP_FAILED);
+  TEST_ASSERT_EQUAL(0, mprotect(mapping, page, PROT_NONE));
+  uint8_t *stack = mapping + page;
+  memset(stack, kStack_paint, kStack_size);
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  TEST_ASSERT_EQUAL(0, pthread_attr_setstack(&attr, stack, kStack_size));
+
+  pthread_t thread;
+  TEST_ASSERT_EQUAL(0, pthread_create(&thread, &attr, decode_thread, NULL));
+  pthread_join(thread, NULL);
+  pthread_attr_destroy(&attr);
+
+  // The stack grows down, the painted bytes left at the bottom were never touched
+  size_t untouched = 0;
+  while (untouched < kStack_size && stack[untouched] == kStack_paint)
+    ++untouched;
+  munmap(mapping, page + kStack_size);
+
+#if LDPC_LANES > 1
+  compare_batch();
+#endif
+
+  char message[160];
+  snprintf(message, sizeof(message),
+           "%d codewords: ldpc_decode %d ok, bp_decode %d ok, %zu of %zu stack bytes used",
+           kCodewords, results.ref_ok, results.bp_ok, kStack_size - untouched, kStack_size);
+  TEST_MESSAGE(message);
+
+  TEST_ASSERT_TRUE(untouched > 0);
+  TEST_ASSERT_EQUAL(0, results.disagree);
+
+  // The min-sum approximations of bp_decode() may lose a marginal codeword
+  TEST_ASSERT_TRUE(results.both_ok > kCodewords / 2);
+  TEST_ASSERT_TRUE(results.bp_ok >= results.ref_ok * 9 / 10);
+  TEST_ASSERT_EQUAL(0, results.batch_differ);
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_decoders_agree_on_a_small_stack);
+  return UNITY_END();
+}
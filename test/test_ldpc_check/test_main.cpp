@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unity.h>
+
+#include "constants.h"
+#include "encode.h"
+#include "ldpc.h"
+
+// Packed parity checks of ldpc_check() against the original row walk over
+// one byte per bit, and how long each takes
+
+static const int kRandom_codewords = 10000;
+
+static void to_bytes(const Bits174 *packed, uint8_t bits[174])
+{
+  for (int i = 0; i < N; ++i)
+    bits[i] = (packed->word[i / 64] >> (63 - i % 64)) & 1;
+}
+
+// ldpc_check() as it was before the codeword was packed
+static int reference_check(const uint8_t codeword[])
+{
+  int errors = 0;
+  for (int j = 0; j < M; ++j)
+  {
+    uint8_t x = 0;
+    for (int i = 0; i < kNrw[j]; ++i)
+      x ^= codeword[kNm[j][i] - 1];
+    if (x != 0)
+      ++errors;
+  }
+  return errors;
+}
+
+static uint64_t random_word(void)
+{
+  return ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ (uint64_t)rand();
+}
+
+static void random_codeword(Bits174 *codeword)
+{
+  codeword->word[0] = random_word();
+  codeword->word[1] = random_word();
+  codeword->word[2] = random_word() & ~((1ULL << (192 - 174)) - 1);
+}
+
+// A valid codeword of a random message, through encode174()
+static void encoded_codeword(Bits174 *codeword)
+{
+  uint8_t message[K_BYTES];
+  for (int i = 0; i < K_BYTES; ++i)
+    message[i] = rand();
+  message[K_BYTES - 1] &= 0xE0; // 91 bits
+
+  uint8_t bytes[22];
+  encode174(message, bytes);
+
+  memset(codeword, 0, sizeof(*codeword));
+  for (int i = 0; i < 22; ++i)
+    codeword->word[i / 8] |= (uint64_t)bytes[i] << (56 - 8 * (i % 8));
+}
+
+static double elapsed_ns(const struct timespec *start)
+{
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+void setUp(void) { srand(1); }
+void tearDown(void) {}
+
+void test_random_codewords_match_row_walk(void)
+{
+  for (int n = 0; n < kRandom_codewords; ++n)
+  {
+    Bits174 codeword;
+    uint8_t bits[174];
+    random_codeword(&codeword);
+    to_bytes(&codeword, bits);
+    TEST_ASSERT_EQUAL_INT(reference_check(bits), ldpc_check(&codeword));
+  }
+}
+
+void test_encoded_codewords_pass(void)
+{
+  for (int n = 0; n < 1000; ++n)
+  {
+    Bits174 codeword;
+    encoded_codeword(&codeword);
+    TEST_ASSERT_EQUAL_INT(0, ldpc_check(&codeword));
+
+    // Every bit takes part in three checks
+    int bit = rand() % N;
+    codeword.word[bit / 64] ^= 1ULL << (63 - bit % 64);
+    TEST_ASSERT_EQUAL_INT(3, ldpc_check(&codeword));
+  }
+}
+
+void test_pack_bits_match(void)
+{
+  for (int n = 0; n < 1000; ++n)
+  {
+    Bits174 codeword;
+    uint8_t bits[174];
+    random_codeword(&codeword);
+    to_bytes(&codeword, bits);
+
+    int num_bits = 1 + rand() % N;
+    uint8_t expected[22], packed[22];
+    pack_bits(bits, num_bits, expected);
+    pack_bits(&codeword, num_bits, packed);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, packed, (num_bits + 7) / 8);
+  }
+}
+
+void test_benchmark(void)
+{
+  static Bits174 codewords[kRandom_codewords];
+  static uint8_t bits[kRandom_codewords][174];
+  for (int n = 0; n < kRandom_codewords; ++n)
+  {
+    random_codeword(&codewords[n]);
+    to_bytes(&codewords[n], bits[n]);
+  }
+
+  struct timespec start;
+  volatile int sink = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int n = 0; n < kRandom_codewords; ++n)
+    sink += reference_check(bits[n]);
+  double reference_ns = elapsed_ns(&start) / kRandom_codewords;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int n = 0; n < kRandom_codewords; ++n)
+    sink += ldpc_check(&codewords[n]);
+  double packed_ns = elapsed_ns(&start) / kRandom_codewords;
+
+  char message[96];
+  snprintf(message, sizeof(message), "ldpc_check: row walk %.0f ns, packed %.0f ns per codeword", reference_ns, packed_ns);
+  TEST_MESSAGE(message);
+  (void)sink;
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_random_codewords_match_row_walk);
+  RUN_TEST(test_encoded_codewords_pass);
+  RUN_TEST(test_pack_bits_match);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,398 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "log_journal.h"
+
+// The log journal on a simulated card. Writes land a 512-byte sector at a
+// time and each operation adds to a simulated clock, so the time a flush
+// takes can be measured for cards of different speeds. The power can be
+// cut after any number of sector writes, after which the card is remounted
+// and the journal replayed; the log must then hold either none or all of
+// the lines of the interrupted flush.
+
+#define SIM_FILES 4
+#define SIM_FILE_SIZE 16384
+#define SIM_SECTOR 512
+#define SIM_UNLIMITED 0x7FFFFFFF
+
+static const char *kJournal_name = "ADIF.JNL";
+static const char *kLog_name = "20260112.adi";
+static const uint32_t kFlush_budget_us = 50000; // of the flush task
+
+struct Card_Timing
+{
+  const char *name;
+  uint32_t open_us;
+  uint32_t read_us;  // per sector
+  uint32_t write_us; // per sector
+  uint32_t sync_us;  // directory entry and FAT update
+  uint32_t stall_every; // sector writes between garbage collection stalls, 0 for none
+  uint32_t stall_us;
+};
+
+static const Card_Timing kCards[] = {
+    {"fast card", 300, 80, 250, 1000, 0, 0},
+    {"slow card", 1500, 400, 2000, 4000, 0, 0},
+    {"slow card with stalls", 1500, 400, 2000, 4000, 16, 150000},
+};
+
+struct Sim_File
+{
+  bool used;
+  bool is_open;
+  char name[JOURNAL_NAME_SIZE];
+  uint32_t size;
+  uint8_t data[SIM_FILE_SIZE];
+};
+
+static Sim_File card[SIM_FILES];
+static const Card_Timing *timing = &kCards[0];
+static uint64_t clock_us;
+static int32_t writes_left; // sector writes before the power goes
+static uint32_t sector_writes;
+static const char *refuse_open; // a file name open() fails for
+
+static void *sim_open(const char *name)
+{
+  clock_us += timing->open_us;
+  if (refuse_open != NULL && strcmp(name, refuse_open) == 0)
+    return NULL;
+
+  Sim_File *free_file = NULL;
+  for (Sim_File &file : card)
+  {
+    if (file.used && strcmp(file.name, name) == 0)
+    {
+      file.is_open = true;
+      return &file;
+    }
+    if (!file.used && free_file == NULL)
+      free_file = &file;
+  }
+
+  if (free_file == NULL)
+    return NULL;
+  memset(free_file, 0, sizeof(*free_file));
+  free_file->used = true;
+  free_file->is_open = true;
+  strcpy(free_file->name, name);
+  return free_file;
+}
+
+static void sim_close(void *file)
+{
+  ((Sim_File *)file)->is_open = false;
+}
+
+static uint32_t sim_size(void *file)
+{
+  return ((Sim_File *)file)->size;
+}
+
+static uint32_t sim_read(void *file, uint32_t offset, void *data, uint32_t len)
+{
+  Sim_File *f = (Sim_File *)file;
+  if (offset >= f->size)
+    return 0;
+  if (len > f->size - offset)
+    len = f->size - offset;
+
+  clock_us += (uint64_t)timing->read_us * ((offset % SIM_SECTOR + len + SIM_SECTOR - 1) / SIM_SECTOR);
+  memcpy(data, f->data + offset, len);
+  return len;
+}
+
+// One sector at a time, a partial sector that holds data is read first
+static uint32_t sim_write(void *file, uint32_t offset, const void *data, uint32_t len)
+{
+  Sim_File *f = (Sim_File *)file;
+  uint32_t done = 0;
+
+  while (done < len && offset + done < SIM_FILE_SIZE)
+  {
+    if (writes_left <= 0)
+      break;
+    writes_left--;
+
+    uint32_t pos = offset + done;
+    uint32_t piece = SIM_SECTOR - pos % SIM_SECTOR;
+    if (piece > len - done)
+      piece = len - done;
+
+    if (piece < SIM_SECTOR && pos - pos % SIM_SECTOR < f->size)
+      clock_us += timing->read_us;
+    clock_us += timing->write_us;
+    if (timing->stall_every != 0 && ++sector_writes % timing->stall_every == 0)
+      clock_us += timing->stall_us;
+
+    memcpy(f->data + pos, (const uint8_t *)data + done, piece);
+    done += piece;
+    if (pos + piece > f->size)
+      f->size = pos + piece;
+  }
+  return done;
+}
+
+static void sim_truncate(void *file, uint32_t size)
+{
+  if (writes_left <= 0)
+    return;
+  writes_left--;
+
+  clock_us += timing->sync_us;
+  Sim_File *f = (Sim_File *)file;
+  if (size < f->size)
+    f->size = size;
+}
+
+static void sim_sync(void *file)
+{
+  (void)file;
+  clock_us += timing->sync_us;
+}
+
+static const Journal_Files sim_files = {
+    sim_open, sim_close, sim_size, sim_read, sim_write, sim_truncate, sim_sync};
+
+static void format_card(const Card_Timing *card_timing)
+{
+  memset(card, 0, sizeof(card));
+  timing = card_timing;
+  clock_us = 0;
+  writes_left = SIM_UNLIMITED;
+  sector_writes = 0;
+  refuse_open = NULL;
+}
+
+// Open files are forgotten, only what reached the card survives
+static Journal remount(char *replayed_name, uint32_t *replayed)
+{
+  for (Sim_File &file : card)
+    file.is_open = false;
+  writes_left = SIM_UNLIMITED;
+
+  Journal journal;
+  static char scratch[JOURNAL_MAX_DATA];
+  char file_name[JOURNAL_NAME_SIZE] = "";
+  journal_init(&journal, &sim_files, kJournal_name);
+  uint32_t bytes = journal_replay(&journal, scratch, file_name);
+  if (replayed_name != NULL)
+    strcpy(replayed_name, file_name);
+  if (replayed != NULL)
+    *replayed = bytes;
+  return journal;
+}
+
+static const Sim_File *find_file(const char *name)
+{
+  for (const Sim_File &file : card)
+  {
+    if (file.used && strcmp(file.name, name) == 0)
+      return &file;
+  }
+  return NULL;
+}
+
+static bool log_equals(const char *expected)
+{
+  const Sim_File *log = find_file(kLog_name);
+  size_t len = strlen(expected);
+  if (log == NULL)
+    return len == 0;
+  return log->size == len && memcmp(log->data, expected, len) == 0;
+}
+
+static bool no_open_files(void)
+{
+  for (const Sim_File &file : card)
+  {
+    if (file.is_open)
+      return false;
+  }
+  return true;
+}
+
+// count ADIF records of about 240 characters each, CRLF terminated
+static void make_lines(char *data, int first, int count)
+{
+  data[0] = 0;
+  for (int i = 0; i < count; i++)
+  {
+    char line[256];
+    snprintf(line, sizeof(line),
+             "<call:5>G%04d <gridsquare:4>IO91 <mode:3>FT8 <rst_sent:3>-10 <rst_rcvd:3>-12 "
+             "<qso_date:8>20260112 <time_on:6>1015%02d <qso_date_off:8>20260112 <time_off:6>1016%02d "
+             "<band:3>20m <freq:9>14.075500 <station_callsign:5>G8KIG <my_gridsquare:4>IO91 <eor>\r\n",
+             first + i, i % 60, i % 60);
+    strcat(data, line);
+  }
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_flush_time_by_card(void)
+{
+  static char lines[JOURNAL_MAX_DATA];
+  static char expected[SIM_FILE_SIZE];
+
+  for (const Card_Timing &card_timing : kCards)
+  {
+    format_card(&card_timing);
+    Journal journal = remount(NULL, NULL);
+    TEST_ASSERT_EQUAL_INT(JOURNAL_SIZE, find_file(kJournal_name)->size);
+
+    // A QSO or two per flush, as the log task sees them
+    expected[0] = 0;
+    uint64_t total_us = 0, worst_us = 0;
+    const int flushes = 24;
+    for (int n = 0; n < flushes; n++)
+    {
+      make_lines(lines, n * 2, 1 + n % 2);
+      strcat(expected, lines);
+
+      uint64_t start = clock_us;
+      TEST_ASSERT_TRUE(journal_append(&journal, kLog_name, lines, strlen(lines)));
+      uint64_t elapsed = clock_us - start;
+      total_us += elapsed;
+      if (elapsed > worst_us)
+        worst_us = elapsed;
+    }
+
+    TEST_ASSERT_TRUE(log_equals(expected));
+    TEST_ASSERT_TRUE(no_open_files());
+
+    char message[160];
+    snprintf(message, sizeof(message), "%s: %.1f ms per flush, worst %.1f ms, task budget %.0f ms",
+             card_timing.name, total_us / 1000.0 / flushes, worst_us / 1000.0, kFlush_budget_us / 1000.0);
+    TEST_MESSAGE(message);
+
+    // Without stalls a flush fits the budget of the flush task
+    if (card_timing.stall_every == 0)
+      TEST_ASSERT_TRUE(worst_us < kFlush_budget_us);
+  }
+}
+
+void test_power_cut_at_every_write(void)
+{
+  static char first[JOURNAL_MAX_DATA];
+  static char second[JOURNAL_MAX_DATA];
+  static char both[2 * JOURNAL_MAX_DATA];
+
+  // The second flush spans several sectors of the journal
+  make_lines(first, 0, 2);
+  make_lines(second, 2, 6);
+  strcpy(both, first);
+  strcat(both, second);
+
+  // Count the sector writes of an uninterrupted second flush
+  format_card(&kCards[0]);
+  Journal journal = remount(NULL, NULL);
+  TEST_ASSERT_TRUE(journal_append(&journal, kLog_name, first, strlen(first)));
+  writes_left = SIM_UNLIMITED;
+  TEST_ASSERT_TRUE(journal_append(&journal, kLog_name, second, strlen(second)));
+  int32_t total_writes = SIM_UNLIMITED - writes_left;
+
+  int kept_old = 0, replayed_new = 0;
+  for (int32_t cut = 0; cut <= total_writes; cut++)
+  {
+    format_card(&kCards[0]);
+    journal = remount(NULL, NULL);
+    TEST_ASSERT_TRUE(journal_append(&journal, kLog_name, first, strlen(first)));
+
+    writes_left = cut;
+    journal_append(&journal, kLog_name, second, strlen(second));
+
+    char replayed_name[JOURNAL_NAME_SIZE];
+    uint32_t replayed;
+    remount(replayed_name, &replayed);
+
+    if (log_equals(first))
+    {
+      kept_old++;
+    }
+    else
+    {
+      TEST_ASSERT_TRUE_MESSAGE(log_equals(both), "log holds part of a flush");
+      replayed_new++;
+    }
+    if (replayed > 0)
+    {
+      TEST_ASSERT_EQUAL_STRING(kLog_name, replayed_name);
+      TEST_ASSERT_EQUAL_INT(strlen(second), replayed);
+    }
+  }
+
+  char message[120];
+  snprintf(message, sizeof(message), "%d cut points: %d left the log as it was, %d ended with the flush",
+           (int)total_writes + 1, kept_old, replayed_new);
+  TEST_MESSAGE(message);
+
+  TEST_ASSERT_TRUE(kept_old > 0);
+  TEST_ASSERT_TRUE(replayed_new > 0);
+}
+
+void test_failed_flush_is_retried_once(void)
+{
+  static char first[JOURNAL_MAX_DATA];
+  static char second[JOURNAL_MAX_DATA];
+  static char both[2 * JOURNAL_MAX_DATA];
+  make_lines(first, 0, 1);
+  make_lines(second, 1, 4);
+  strcpy(both, first);
+  strcat(both, second);
+
+  // The card stops taking writes part way and comes back without a reboot
+  for (int32_t cut = 0; cut < 16; cut++)
+  {
+    format_card(&kCards[0]);
+    Journal journal = remount(NULL, NULL);
+    TEST_ASSERT_TRUE(journal_append(&journal, kLog_name, first, strlen(first)));
+
+    writes_left = cut;
+    bool ok = journal_append(&journal, kLog_name, second, strlen(second));
+    writes_left = SIM_UNLIMITED;
+    if (!ok)
+      TEST_ASSERT_TRUE(journal_append(&journal, kLog_name, second, strlen(second)));
+
+    TEST_ASSERT_TRUE(log_equals(both));
+    TEST_ASSERT_TRUE(no_open_files());
+  }
+}
+
+void test_journal_open_failure_leaves_the_log(void)
+{
+  static char lines[JOURNAL_MAX_DATA];
+  make_lines(lines, 0, 2);
+
+  format_card(&kCards[0]);
+  Journal journal = remount(NULL, NULL);
+
+  refuse_open = kJournal_name;
+  TEST_ASSERT_FALSE(journal_append(&journal, kLog_name, lines, strlen(lines)));
+  TEST_ASSERT_NULL(find_file(kLog_name));
+
+  refuse_open = kLog_name;
+  TEST_ASSERT_FALSE(journal_append(&journal, kLog_name, lines, strlen(lines)));
+  TEST_ASSERT_TRUE(no_open_files());
+
+  refuse_open = NULL;
+  TEST_ASSERT_TRUE(journal_append(&journal, kLog_name, lines, strlen(lines)));
+  TEST_ASSERT_TRUE(log_equals(lines));
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_flush_time_by_card);
+  RUN_TEST(test_power_cut_at_every_write);
+  RUN_TEST(test_failed_flush_is_retried_once);
+  RUN_TEST(test_journal_open_failure_leaves_the_log);
+  return UNITY_END();
+}
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+#include "si5351_regs.h"
+
+// Tone keying through ms_load() against an I2C recorder standing in for the
+// Si5351: the registers it ends up holding, the bytes sent per symbol and
+// how long those take on the bus
+
+static const uint64_t kPll_freq = 80000000000ULL; // 800 MHz in 0.01 Hz, the library's fixed PLL
+static const uint8_t kClk0_parameters = 42;
+static const int kTone_spacing = 625; // 6.25 Hz
+static const int kTone_levels = 16;
+static const int kLevels = 7 * kTone_levels + 1;
+static const int kSymbols = 79;
+static const uint32_t kI2C_clock = 100000; // Wire default
+
+struct I2C_Recorder
+{
+  uint8_t registers[256];
+  int bursts;
+  int bytes; // register address and data bytes
+};
+
+static I2C_Recorder recorder;
+
+static void record_write(uint8_t addr, uint8_t bytes, uint8_t *data)
+{
+  memcpy(recorder.registers + addr, data, bytes);
+  recorder.bursts++;
+  recorder.bytes += 1 + bytes;
+}
+
+// Start, device address, the bytes with an ACK bit each, then stop
+static double burst_us(int bytes)
+{
+  return (1 + 9 * (1 + bytes) + 1) * 1e6 / kI2C_clock;
+}
+
+// Output frequency in Hz of the multisynth image held by the recorder
+static double loaded_frequency(void)
+{
+  const uint8_t *r = recorder.registers + kClk0_parameters;
+  uint32_t p3 = ((uint32_t)(r[5] & 0xF0) << 12) | (r[0] << 8) | r[1];
+  uint32_t p1 = ((uint32_t)(r[2] & 0x03) << 16) | (r[3] << 8) | r[4];
+  uint32_t p2 = ((uint32_t)(r[5] & 0x0F) << 16) | (r[6] << 8) | r[7];
+  double divider = (p1 + 512 + (double)p2 / p3) / 128.0;
+  return kPll_freq / 100.0 / divider;
+}
+
+static uint8_t level_regs[kLevels][MS_REGS];
+
+static void prepare_levels(uint64_t dial_freq)
+{
+  for (int level = 0; level < kLevels; ++level)
+  {
+    uint64_t offset = ((uint64_t)level * kTone_spacing + kTone_levels / 2) / kTone_levels;
+    calc_ms_regs(kPll_freq, dial_freq + offset, level_regs[level]);
+  }
+}
+
+void setUp(void)
+{
+  memset(&recorder, 0, sizeof(recorder));
+  srand(3);
+}
+
+void tearDown(void) {}
+
+void test_levels_land_on_their_frequencies(void)
+{
+  const uint64_t dial_freq = 1407400000ULL + 150000; // 14.074 MHz + 1500 Hz
+  prepare_levels(dial_freq);
+
+  Ms_Image image = {};
+  double previous = 0;
+  for (int level = 0; level < kLevels; ++level)
+  {
+    ms_load(&image, kClk0_parameters, level_regs[level], record_write);
+    double expected = (dial_freq + (double)level * kTone_spacing / kTone_levels) / 100.0;
+    double actual = loaded_frequency();
+
+    // A divider resolution of 1e-6 is about 0.25 Hz at 20 m
+    TEST_ASSERT_FLOAT_WITHIN(0.3, expected, actual);
+    if (level > 0)
+      TEST_ASSERT_GREATER_THAN(previous, actual);
+    previous = actual;
+  }
+}
+
+void test_symbols_send_only_changed_registers(void)
+{
+  const uint64_t bands[] = {184000000ULL, 707400000ULL, 1407400000ULL, 2807400000ULL, 5031300000ULL};
+  int worst = 0;
+  long total = 0, symbols = 0;
+
+  for (uint64_t dial : bands)
+  {
+    uint64_t dial_freq = dial + 100 * (200 + rand() % 2500);
+    prepare_levels(dial_freq);
+
+    Ms_Image image = {};
+    memset(&recorder, 0, sizeof(recorder));
+
+    // The first tone is written in full
+    uint8_t tone = rand() % 8;
+    TEST_ASSERT_EQUAL_INT(MS_REGS, ms_load(&image, kClk0_parameters, level_regs[tone * kTone_levels], record_write));
+
+    for (int k = 1; k < kSymbols; ++k)
+    {
+      uint8_t next = rand() % 8;
+      int bursts = recorder.bursts;
+      int sent = ms_load(&image, kClk0_parameters, level_regs[next * kTone_levels], record_write);
+
+      // One burst or none, never more registers than the image holds
+      TEST_ASSERT_EQUAL_INT(bursts + (sent ? 1 : 0), recorder.bursts);
+      TEST_ASSERT_LESS_THAN(MS_REGS, sent);
+      if (next == tone)
+        TEST_ASSERT_EQUAL_INT(0, sent);
+      TEST_ASSERT_EQUAL_MEMORY(level_regs[next * kTone_levels], recorder.registers + kClk0_parameters, MS_REGS);
+
+      if (sent > worst)
+        worst = sent;
+      total += sent;
+      symbols++;
+      tone = next;
+    }
+  }
+
+  char message[128];
+  snprintf(message, sizeof(message), "per symbol: avg %.1f registers, worst %d (%.0f us), full image %.0f us at %lu Hz",
+           (double)total / symbols, worst, burst_us(1 + worst), burst_us(1 + MS_REGS), (unsigned long)kI2C_clock);
+  TEST_MESSAGE(message);
+
+  // Well inside the 5 ms step of a shaped transmission
+  TEST_ASSERT_LESS_THAN(1000.0, burst_us(1 + worst));
+}
+
+void test_gfsk_steps_send_at_most_the_fraction(void)
+{
+  prepare_levels(1407400000ULL + 150000);
+
+  Ms_Image image = {};
+  ms_load(&image, kClk0_parameters, level_regs[0], record_write);
+
+  // Neighbouring levels, as a shaped transmission walks them
+  for (int level = 1; level < kLevels; ++level)
+  {
+    int sent = ms_load(&image, kClk0_parameters, level_regs[level], record_write);
+    TEST_ASSERT_LESS_THAN(MS_REGS, sent);
+    TEST_ASSERT_EQUAL_MEMORY(level_regs[level], recorder.registers + kClk0_parameters, MS_REGS);
+  }
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_levels_land_on_their_frequencies);
+  RUN_TEST(test_symbols_send_only_changed_registers);
+  RUN_TEST(test_gfsk_steps_send_at_most_the_fraction);
+  return UNITY_END();
+}
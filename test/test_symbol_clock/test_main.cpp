@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unity.h>
+
+#include "symbol_clock.h"
+
+// The TX symbol clock driven by a simulated IntervalTimer on a mocked
+// micros(): every step must be keyed at its boundary from the slot start,
+// in order, whatever time the transmission starts and however late the
+// interrupt runs
+
+static const int kShaped_steps = 32; // GFSK_STEPS
+
+struct Keyed_Step
+{
+  int step;
+  uint32_t time_us;
+};
+
+static Keyed_Step keyed[TX_SYMBOLS * 32];
+static int num_keyed;
+
+// Run a transmission the way tx_scheduler does, with the timer's first
+// period set to the returned delay and a fixed period after that. The
+// interrupt runs up to max_latency_us after the timer fires
+static Symbol_Clock run_transmission(int steps, uint32_t slot_start_ms, uint32_t start_us, uint32_t max_latency_us)
+{
+  Symbol_Clock clock;
+  num_keyed = 0;
+
+  uint32_t delay_us = symbol_clock_start(&clock, steps, slot_start_ms, start_us);
+  if (delay_us == 0)
+    return clock;
+
+  uint32_t fire_us = start_us + delay_us;
+  for (int tick = 0; tick < TX_END_BLOCK * steps && !symbol_clock_done(&clock); ++tick)
+  {
+    uint32_t now_us = fire_us + (max_latency_us ? rand() % (max_latency_us + 1) : 0);
+    int step = symbol_clock_tick(&clock, now_us);
+    if (step >= 0)
+    {
+      keyed[num_keyed].step = step;
+      keyed[num_keyed].time_us = fire_us;
+      num_keyed++;
+    }
+    fire_us += FT8_SYMBOL_US / steps;
+  }
+  return clock;
+}
+
+// Every step keyed once, in order, on its own boundary, the whole message
+// late_us after it was due
+static void check_steps(int steps, uint32_t slot_start_ms, uint32_t late_us = 0)
+{
+  uint32_t step_us = FT8_SYMBOL_US / steps;
+  TEST_ASSERT_EQUAL_INT(TX_SYMBOLS * steps, num_keyed);
+  for (int i = 0; i < num_keyed; ++i)
+  {
+    TEST_ASSERT_EQUAL_INT(i, keyed[i].step);
+    uint32_t due_us = slot_start_ms * 1000u + (TX_FIRST_BLOCK * steps + i) * step_us + late_us;
+    TEST_ASSERT_EQUAL_UINT32(due_us, keyed[i].time_us);
+  }
+}
+
+void setUp(void) { srand(4); }
+void tearDown(void) {}
+
+void test_symbols_on_160ms_boundaries(void)
+{
+  const uint32_t slot_start_ms = 1000000;
+  Symbol_Clock clock = run_transmission(1, slot_start_ms, slot_start_ms * 1000u + 300000, 0);
+
+  check_steps(1, slot_start_ms);
+  TEST_ASSERT_TRUE(symbol_clock_done(&clock));
+  TEST_ASSERT_EQUAL_INT32(0, clock.stats.min_error_us);
+  TEST_ASSERT_EQUAL_INT32(0, clock.stats.max_error_us);
+}
+
+void test_late_start_sends_the_whole_message_late(void)
+{
+  const uint32_t slot_start_ms = 1000000;
+  const uint32_t first_due_us = TX_FIRST_BLOCK * FT8_SYMBOL_US;
+
+  // 2.05 s into the slot, the next boundary is block 13, five symbols late
+  run_transmission(1, slot_start_ms, slot_start_ms * 1000u + 2050000, 0);
+  check_steps(1, slot_start_ms, 2080000 - first_due_us);
+
+  // Exactly on a boundary waits for the next one
+  run_transmission(1, slot_start_ms, slot_start_ms * 1000u + 2080000, 0);
+  check_steps(1, slot_start_ms, 2240000 - first_due_us);
+
+  // Shaped steps move to the next 5 ms boundary
+  run_transmission(kShaped_steps, slot_start_ms, slot_start_ms * 1000u + first_due_us + 1, 0);
+  check_steps(kShaped_steps, slot_start_ms, FT8_SYMBOL_US / kShaped_steps);
+}
+
+void test_too_late_skips_the_slot(void)
+{
+  const uint32_t slot_start_ms = 1000000;
+  // Starts before the last boundary within TX_MAX_LATE_US of the first symbol
+  // are keyed from it, a start on that boundary waits for the next one
+  const uint32_t last_start_us = slot_start_ms * 1000u + TX_FIRST_BLOCK * FT8_SYMBOL_US +
+                                 TX_MAX_LATE_US / FT8_SYMBOL_US * FT8_SYMBOL_US;
+  Symbol_Clock clock;
+
+  TEST_ASSERT_TRUE(symbol_clock_start(&clock, 1, slot_start_ms, last_start_us - 1) > 0);
+  TEST_ASSERT_EQUAL_UINT32(0, symbol_clock_start(&clock, 1, slot_start_ms, last_start_us));
+  TEST_ASSERT_TRUE(symbol_clock_done(&clock));
+
+  // The latest start, on the step boundary, still ends inside the slot
+  run_transmission(1, slot_start_ms, last_start_us - 1, 0);
+  TEST_ASSERT_EQUAL_INT(TX_SYMBOLS, num_keyed);
+  TEST_ASSERT_TRUE(keyed[TX_SYMBOLS - 1].time_us + FT8_SYMBOL_US <= slot_start_ms * 1000u + 15000000);
+}
+
+// millis() * 1000 and micros() both wrap at 2^32 us, about 71 minutes
+void test_micros_wrap(void)
+{
+  const uint32_t slot_start_ms = 4294960; // 4294.960 s, micros() wraps 7.3 s into the slot
+  run_transmission(1, slot_start_ms, slot_start_ms * 1000u + 100000, 0);
+  check_steps(1, slot_start_ms);
+
+  run_transmission(kShaped_steps, slot_start_ms, slot_start_ms * 1000u + 100000, 0);
+  check_steps(kShaped_steps, slot_start_ms);
+}
+
+void test_interrupt_latency_does_not_accumulate(void)
+{
+  const uint32_t slot_start_ms = 123456;
+  const uint32_t max_latency_us = 50;
+  Symbol_Clock clock = run_transmission(1, slot_start_ms, slot_start_ms * 1000u, max_latency_us);
+
+  check_steps(1, slot_start_ms);
+  TEST_ASSERT_GREATER_OR_EQUAL(0, clock.stats.min_error_us);
+  TEST_ASSERT_LESS_OR_EQUAL((int32_t)max_latency_us, clock.stats.max_error_us);
+  TEST_ASSERT_EQUAL_UINT32(TX_END_BLOCK - 1, clock.stats.ticks);
+
+  int32_t avg_us = (int32_t)(clock.stats.sum_error_us / clock.stats.ticks);
+  char message[96];
+  snprintf(message, sizeof(message), "error min %ld avg %ld max %ld us over %lu ticks",
+           (long)clock.stats.min_error_us, (long)avg_us, (long)clock.stats.max_error_us,
+           (unsigned long)clock.stats.ticks);
+  TEST_MESSAGE(message);
+}
+
+void test_shaped_steps(void)
+{
+  const uint32_t slot_start_ms = 1000000;
+  run_transmission(kShaped_steps, slot_start_ms, slot_start_ms * 1000u + 1000, 20);
+  check_steps(kShaped_steps, slot_start_ms);
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_symbols_on_160ms_boundaries);
+  RUN_TEST(test_late_start_sends_the_whole_message_late);
+  RUN_TEST(test_too_late_skips_the_slot);
+  RUN_TEST(test_micros_wrap);
+  RUN_TEST(test_interrupt_latency_does_not_accumulate);
+  RUN_TEST(test_shaped_steps);
+  return UNITY_END();
+}